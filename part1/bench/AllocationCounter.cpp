@@ -0,0 +1,40 @@
+#include "AllocationCounter.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<size_t> g_allocations{0};
+static std::atomic<size_t> g_allocated_bytes{0};
+
+size_t AllocationCount()
+{
+    return g_allocations.load(std::memory_order_relaxed);
+}
+
+size_t AllocatedBytes()
+{
+    return g_allocated_bytes.load(std::memory_order_relaxed);
+}
+
+void *operator new(size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    void *memory = malloc(size > 0 ? size : 1);
+    if (memory == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void operator delete(void *memory) noexcept
+{
+    free(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept
+{
+    free(memory);
+}
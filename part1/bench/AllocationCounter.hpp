@@ -0,0 +1,22 @@
+/** @file AllocationCounter.hpp
+ *  @brief Counts every heap allocation the program makes.
+ *
+ *  Linking AllocationCounter.cpp replaces the global operator new with one
+ *  that counts calls and bytes, so the allocations of a piece of code are
+ *  the difference of the counters around it. Used by the benchmark and by
+ *  the tests that check the decode loop does not allocate.
+ *
+ *  @author Tvcz
+ *  @bug No known bugs.
+ */
+#ifndef ALLOCATIONCOUNTER_HPP
+#define ALLOCATIONCOUNTER_HPP
+
+#include <cstddef>
+
+// Heap allocations made since the program started, from every thread
+size_t AllocationCount();
+// Bytes asked for by those allocations
+size_t AllocatedBytes();
+
+#endif
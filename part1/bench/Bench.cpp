@@ -0,0 +1,426 @@
+/** @file Bench.cpp
+ *  @brief Decoder benchmark, run over a directory of GIF and PPM files.
+ *
+ *  Times every stage of loading each file on its own, without a window or
+ *  an OpenGL context: for GIFs parsing the block structure, LZW decoding
+ *  next to the original decoder it replaced, mapping color indices onto
+ *  the canvas and the whole LoadGIF at 1, 2, 4 and 8 decode threads; for
+ *  PPMs the whole LoadPPM, flipping, building the mip chain, plain and
+ *  gamma correct, and block compressing to BC1 and RGTC2. Each stage
+ *  reports the best of several runs as MB/s and pixels/s, plus the heap
+ *  allocations one run makes. Results can be written as JSON to compare
+ *  runs across releases.
+ *
+ *  Build with: python3 build.py bench
+ *  Run with:   ./bench <corpus directory> [--iterations N] [--json file]
+ *
+ *  @author Tvcz
+ *  @bug No known bugs.
+ */
+#include "AllocationCounter.hpp"
+#include "BlockCompress.hpp"
+#include "Image.hpp"
+#include "FrameWriter.hpp"
+#include "GifIndex.hpp"
+#include "LZWDecoder.hpp"
+#include "LZWReference.hpp"
+#include "Log.hpp"
+#include "MappedFile.hpp"
+#include "MipChain.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+struct StageResult
+{
+    std::string name;
+    // best of all runs
+    double seconds = 0.0;
+    // bytes read by the stage, and pixels it produced
+    size_t bytes = 0;
+    size_t pixels = 0;
+    // made by a single run
+    size_t allocations = 0;
+    size_t allocated_bytes = 0;
+    // for the threaded loads, time at 1 thread over this one's, for lzw
+    // time of the reference decoder over this one's
+    double speedup = 0.0;
+};
+
+struct FileResult
+{
+    std::string path;
+    std::string type;
+    size_t file_size = 0;
+    int width = 0;
+    int height = 0;
+    size_t frames = 1;
+    std::vector<StageResult> stages;
+};
+
+// Runs job iterations times and keeps its best time. Allocations are
+// counted on the last run, when caches and pools are warm like they are
+// in the program.
+template <typename Job>
+static StageResult measure(const std::string &name, int iterations, size_t bytes, size_t pixels, Job job)
+{
+    StageResult result;
+    result.name = name;
+    result.bytes = bytes;
+    result.pixels = pixels;
+    for (int i = 0; i < iterations; ++i)
+    {
+        size_t allocations = AllocationCount();
+        size_t allocated_bytes = AllocatedBytes();
+        auto start = std::chrono::steady_clock::now();
+        job();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        result.allocations = AllocationCount() - allocations;
+        result.allocated_bytes = AllocatedBytes() - allocated_bytes;
+        if (i == 0 || seconds < result.seconds)
+        {
+            result.seconds = seconds;
+        }
+    }
+    return result;
+}
+
+// The frame's LZW data decoded into one index per pixel of its rect
+static size_t decodeIndices(const uint8_t *file, const GifFrameInfo &info, std::vector<uint8_t> &indices)
+{
+    FrameWriter writer(indices.data(), indices.size());
+    LZWDecoder decoder;
+    // the minimum code size byte comes right before the sub-blocks
+    decoder.Begin(file[info.data_offset - 1]);
+    const uint8_t *block = file + info.data_offset;
+    const uint8_t *end = block + info.data_size;
+    while (block < end && *block != 0 && !decoder.Finished())
+    {
+        decoder.Decode(block + 1, *block, writer);
+        block += 1 + *block;
+    }
+    return writer.GetPixelsWritten();
+}
+
+static FileResult benchGIF(const std::string &path, int iterations)
+{
+    FileResult result;
+    result.path = path;
+    result.type = "gif";
+    GifIndex index;
+    // the stages below assume a well formed file
+    if (!Image::Probe(path, index))
+    {
+        return result;
+    }
+    result.file_size = index.file_size;
+    result.width = index.width;
+    result.height = index.height;
+    result.frames = index.GetFrameCount();
+
+    size_t canvas_pixels = static_cast<size_t>(index.width) * index.height * index.GetFrameCount();
+    size_t lzw_bytes = 0;
+    size_t rect_pixels = 0;
+    for (const GifFrameInfo &info : index.frames)
+    {
+        lzw_bytes += info.data_size;
+        rect_pixels += static_cast<size_t>(info.rect.width) * info.rect.height;
+    }
+
+    result.stages.push_back(measure("parse", iterations, index.file_size, canvas_pixels,
+                                    [&]()
+                                    {
+                                        GifIndex probed;
+                                        Image::Probe(path, probed);
+                                    }));
+
+    MappedFile file;
+    file.Open(path);
+    std::vector<std::vector<uint8_t>> indices(index.GetFrameCount());
+    for (size_t i = 0; i < indices.size(); ++i)
+    {
+        indices[i].resize(static_cast<size_t>(index.frames[i].rect.width) * index.frames[i].rect.height);
+    }
+    // The decoder LZWDecoder replaced, on the same frames, so the lzw
+    // stage's speedup is measured rather than remembered
+    std::vector<std::vector<uint8_t>> reference(index.GetFrameCount());
+    StageResult lzw_reference = measure("lzw_reference", iterations, lzw_bytes, rect_pixels,
+                                        [&]()
+                                        {
+                                            for (size_t i = 0; i < reference.size(); ++i)
+                                            {
+                                                const GifFrameInfo &info = index.frames[i];
+                                                std::vector<uint8_t> lzw_data = GatherSubBlocksReference(
+                                                    file.GetData() + info.data_offset, info.data_size);
+                                                reference[i] = DecompressLZWReference(
+                                                    lzw_data, file.GetData()[info.data_offset - 1]);
+                                            }
+                                        });
+    result.stages.push_back(lzw_reference);
+    StageResult lzw = measure("lzw", iterations, lzw_bytes, rect_pixels,
+                              [&]()
+                              {
+                                  for (size_t i = 0; i < indices.size(); ++i)
+                                  {
+                                      decodeIndices(file.GetData(), index.frames[i], indices[i]);
+                                  }
+                              });
+    lzw.speedup = lzw.seconds > 0.0 ? lzw_reference.seconds / lzw.seconds : 0.0;
+    result.stages.push_back(lzw);
+    for (size_t i = 0; i < indices.size(); ++i)
+    {
+        // the old decoder keeps whatever follows the frame's pixels
+        reference[i].resize(std::min(reference[i].size(), indices[i].size()));
+        if (!std::equal(reference[i].begin(), reference[i].end(), indices[i].begin()))
+        {
+            fprintf(stderr, "%s: frame %zu decodes differently with the reference decoder\n", path.c_str(), i);
+        }
+    }
+
+    // The probe does not keep color tables, the lookups cost the same with
+    // any table so a grey ramp stands in for them
+    std::vector<Frame> frames(index.GetFrameCount());
+    for (size_t i = 0; i < frames.size(); ++i)
+    {
+        const GifFrameInfo &info = index.frames[i];
+        frames[i].left = info.rect.x;
+        frames[i].top = info.rect.y;
+        frames[i].width = info.rect.width;
+        frames[i].height = info.rect.height;
+        frames[i].interlaced = info.interlaced;
+        frames[i].transparent_index = info.transparent_index;
+        for (int c = 0; c < 256; ++c)
+        {
+            frames[i].color_table.push_back(Color(c, c, c));
+        }
+    }
+    std::vector<uint8_t> canvas(static_cast<size_t>(index.width) * index.height * 3);
+    result.stages.push_back(measure("palette_map_flip", iterations, rect_pixels, rect_pixels,
+                                    [&]()
+                                    {
+                                        for (size_t i = 0; i < frames.size(); ++i)
+                                        {
+                                            FrameWriter writer(canvas.data(), index.width, index.height, frames[i],
+                                                               true);
+                                            writer.Write(indices[i].data(), indices[i].size());
+                                        }
+                                    }));
+    file.Close();
+
+    double single_thread = 0.0;
+    for (unsigned threads : {1u, 2u, 4u, 8u})
+    {
+        StageResult load = measure("load_threads_" + std::to_string(threads), iterations, index.file_size,
+                                   canvas_pixels,
+                                   [&]()
+                                   {
+                                       Image image(path);
+                                       image.SetDecodeThreads(threads);
+                                       image.LoadGIF(true);
+                                   });
+        if (threads == 1)
+        {
+            single_thread = load.seconds;
+        }
+        load.speedup = load.seconds > 0.0 ? single_thread / load.seconds : 0.0;
+        result.stages.push_back(load);
+    }
+    return result;
+}
+
+static FileResult benchPPM(const std::string &path, int iterations)
+{
+    FileResult result;
+    result.path = path;
+    result.type = "ppm";
+    result.file_size = std::filesystem::file_size(path);
+
+    Image image(path);
+    image.LoadPPM(false);
+    result.width = image.GetWidth();
+    result.height = image.GetHeight();
+    size_t pixels = static_cast<size_t>(result.width) * result.height;
+
+    result.stages.push_back(measure("load", iterations, result.file_size, pixels,
+                                    [&]()
+                                    {
+                                        Image loaded(path);
+                                        loaded.LoadPPM(false);
+                                    }));
+    result.stages.push_back(measure("flip", iterations, pixels * 3, pixels,
+                                    [&]() { image.flipData(image.GetPixelDataPtr()); }));
+    result.stages.push_back(measure("load_flip", iterations, result.file_size, pixels,
+                                    [&]()
+                                    {
+                                        Image loaded(path);
+                                        loaded.LoadPPM(true);
+                                    }));
+
+    // the mip chain is built from the RGBA a texture uploads
+    std::vector<uint8_t> rgba(pixels * 4);
+    const uint8_t *rgb = image.GetPixelDataPtr();
+    for (size_t i = 0; i < pixels; ++i)
+    {
+        rgba[i * 4] = rgb[i * 3];
+        rgba[i * 4 + 1] = rgb[i * 3 + 1];
+        rgba[i * 4 + 2] = rgb[i * 3 + 2];
+        rgba[i * 4 + 3] = 255;
+    }
+    MipChain chain;
+    for (bool gamma_correct : {false, true})
+    {
+        result.stages.push_back(measure(gamma_correct ? "mips_gamma" : "mips", iterations, pixels * 4, pixels,
+                                        [&]()
+                                        { BuildMipChain(rgba.data(), result.width, result.height, gamma_correct,
+                                                        chain); }));
+    }
+    std::vector<uint8_t> blocks(CompressedSize(TextureCompression::RGTC2, result.width, result.height));
+    result.stages.push_back(measure("bc1", iterations, pixels * 4, pixels,
+                                    [&]() { CompressBC1(rgba.data(), result.width, result.height, blocks.data()); }));
+    result.stages.push_back(measure("rgtc2", iterations, pixels * 4, pixels,
+                                    [&]() { CompressRGTC2(rgba.data(), result.width, result.height, blocks.data()); }));
+    return result;
+}
+
+static double perSecond(double amount, double seconds)
+{
+    return seconds > 0.0 ? amount / seconds : 0.0;
+}
+
+static std::string jsonString(const std::string &text)
+{
+    std::string quoted = "\"";
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            quoted += '\\';
+        }
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+static void writeJSON(std::ostream &out, const std::vector<FileResult> &results, int iterations)
+{
+    out << "{\n  \"iterations\": " << iterations << ",\n  \"files\": [";
+    for (size_t f = 0; f < results.size(); ++f)
+    {
+        const FileResult &file = results[f];
+        out << (f > 0 ? "," : "") << "\n    {\"path\": " << jsonString(file.path)
+            << ", \"type\": " << jsonString(file.type) << ", \"file_size\": " << file.file_size
+            << ", \"width\": " << file.width << ", \"height\": " << file.height << ", \"frames\": " << file.frames
+            << ",\n     \"stages\": [";
+        for (size_t s = 0; s < file.stages.size(); ++s)
+        {
+            const StageResult &stage = file.stages[s];
+            out << (s > 0 ? "," : "") << "\n      {\"name\": " << jsonString(stage.name)
+                << ", \"seconds\": " << stage.seconds << ", \"bytes\": " << stage.bytes
+                << ", \"pixels\": " << stage.pixels
+                << ", \"mb_per_second\": " << perSecond(stage.bytes / 1e6, stage.seconds)
+                << ", \"pixels_per_second\": " << perSecond(static_cast<double>(stage.pixels), stage.seconds)
+                << ", \"allocations\": " << stage.allocations << ", \"allocated_bytes\": " << stage.allocated_bytes;
+            if (stage.speedup > 0.0)
+            {
+                out << ", \"speedup\": " << stage.speedup;
+            }
+            out << "}";
+        }
+        out << "\n     ]}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+static void printTable(const std::vector<FileResult> &results)
+{
+    for (const FileResult &file : results)
+    {
+        printf("%s (%dx%d, %zu frames, %zu bytes)\n", file.path.c_str(), file.width, file.height, file.frames,
+               file.file_size);
+        for (const StageResult &stage : file.stages)
+        {
+            printf("  %-18s %10.3f ms %10.1f MB/s %12.3g px/s %8zu allocs %12zu bytes", stage.name.c_str(),
+                   stage.seconds * 1e3, perSecond(stage.bytes / 1e6, stage.seconds),
+                   perSecond(static_cast<double>(stage.pixels), stage.seconds), stage.allocations,
+                   stage.allocated_bytes);
+            if (stage.speedup > 0.0)
+            {
+                printf("  x%.2f", stage.speedup);
+            }
+            printf("\n");
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    std::string corpus;
+    std::string json_path;
+    int iterations = 5;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--iterations" && i + 1 < argc)
+        {
+            iterations = std::max(1, atoi(argv[++i]));
+        }
+        else if (arg == "--json" && i + 1 < argc)
+        {
+            json_path = argv[++i];
+        }
+        else
+        {
+            corpus = arg;
+        }
+    }
+    if (corpus.empty() || !std::filesystem::is_directory(corpus))
+    {
+        fprintf(stderr, "Usage: %s <corpus directory> [--iterations N] [--json file]\n", argv[0]);
+        return 1;
+    }
+    // the loads would otherwise report every file they decode
+    Log::SetLevel(LogLevel::WARN);
+
+    std::vector<std::string> paths;
+    for (const auto &entry : std::filesystem::directory_iterator(corpus))
+    {
+        std::string extension = entry.path().extension().string();
+        if (entry.is_regular_file() && (extension == ".gif" || extension == ".ppm"))
+        {
+            paths.push_back(entry.path().string());
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+
+    std::vector<FileResult> results;
+    for (const std::string &path : paths)
+    {
+        bool gif = path.substr(path.size() - 4) == ".gif";
+        FileResult result = gif ? benchGIF(path, iterations) : benchPPM(path, iterations);
+        if (result.stages.empty())
+        {
+            fprintf(stderr, "Skipping %s, it could not be read\n", path.c_str());
+            continue;
+        }
+        results.push_back(result);
+    }
+
+    printTable(results);
+    if (!json_path.empty())
+    {
+        std::ofstream out(json_path);
+        writeJSON(out, results, iterations);
+        if (!out)
+        {
+            fprintf(stderr, "Failed to write %s\n", json_path.c_str());
+            return 1;
+        }
+    }
+    return 0;
+}
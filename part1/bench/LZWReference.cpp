@@ -0,0 +1,127 @@
+#include "LZWReference.hpp"
+
+#include <stdexcept>
+#include <string>
+
+std::vector<uint8_t> GatherSubBlocksReference(const uint8_t *blocks, size_t size)
+{
+    std::vector<uint8_t> lzw_data;
+    size_t i = 0;
+    while (i < size && blocks[i] != 0x00)
+    {
+        uint8_t sub_block_size = blocks[i++];
+        for (int j = 0; j < sub_block_size && i < size; j++)
+        {
+            lzw_data.push_back(blocks[i++]);
+        }
+    }
+    return lzw_data;
+}
+
+// The old decoder passed bytes by value, copying the whole frame's data
+// for every code. That alone made it quadratic in the frame size, so the
+// baseline takes it by reference and keeps the rest as it was. Bits past
+// the end read as zeros instead of past the buffer.
+static uint16_t getNextCode(const std::vector<uint8_t> &bytes, int &bit_index, int cur_code_size)
+{
+    int byte_index, bit_byte_index;
+    uint16_t code = 0;
+    int bit_pos = 0;
+    for (int i = 0; i < cur_code_size; i++)
+    {
+        byte_index = bit_index / 8;
+        bit_byte_index = bit_index % 8;
+        uint8_t byte = byte_index < static_cast<int>(bytes.size()) ? bytes[byte_index] : 0;
+        uint8_t bit = (byte >> bit_byte_index) & 0b00000001;
+        code = code | (bit << bit_pos);
+        bit_pos++;
+        bit_index++;
+    }
+    if (code > 4095)
+    {
+        throw std::runtime_error("Invalid code size encountered: " + std::to_string(code));
+    }
+    return code;
+}
+
+// collects codes from bytes and decompresses them to color indices
+// https://giflib.sourceforge.net/whatsinagif/lzw_decoding_bytes.gif
+std::vector<uint8_t> DecompressLZWReference(const std::vector<uint8_t> &bytes, uint8_t lzw_min_code_size)
+{
+    int cur_code_size = lzw_min_code_size + 1;
+    const int max_code_size = 12;
+    int bit_index = 0;
+    uint16_t clear_code = 1 << lzw_min_code_size;
+    uint16_t end_of_info_code = clear_code + 1;
+
+    std::vector<uint8_t> decompressed_data;
+
+    std::vector<std::vector<uint8_t>> code_table((1 << lzw_min_code_size) + 2, std::vector<uint8_t>());
+    for (int i = 0; i < (1 << lzw_min_code_size); ++i)
+    {
+        code_table[i] = {static_cast<uint8_t>(i)};
+    }
+
+    uint16_t read_clear_code = getNextCode(bytes, bit_index, cur_code_size);
+    if (read_clear_code != clear_code)
+    {
+        throw std::runtime_error("Read clear code does not match expected clear code");
+    }
+    uint16_t prev_code = getNextCode(bytes, bit_index, cur_code_size);
+    if (prev_code >= code_table.size())
+    {
+        throw std::runtime_error("First code out of range");
+    }
+    decompressed_data.insert(decompressed_data.end(), code_table[prev_code].begin(), code_table[prev_code].end());
+
+    while (bit_index < static_cast<int>(bytes.size()) * 8)
+    {
+        uint16_t curr_code = getNextCode(bytes, bit_index, cur_code_size);
+
+        if (curr_code == clear_code)
+        {
+            code_table.clear();
+            code_table.resize((1 << lzw_min_code_size) + 2, std::vector<uint8_t>());
+            for (int i = 0; i < (1 << lzw_min_code_size); ++i)
+            {
+                code_table[i] = {static_cast<uint8_t>(i)};
+            }
+            cur_code_size = lzw_min_code_size + 1;
+            prev_code = getNextCode(bytes, bit_index, cur_code_size);
+            decompressed_data.insert(decompressed_data.end(), code_table[prev_code].begin(),
+                                     code_table[prev_code].end());
+            continue;
+        }
+        else if (curr_code == end_of_info_code)
+        {
+            break;
+        }
+
+        if (curr_code < code_table.size())
+        {
+            decompressed_data.insert(decompressed_data.end(), code_table[curr_code].begin(),
+                                     code_table[curr_code].end());
+            int k = code_table[curr_code][0];
+            std::vector<uint8_t> new_entry = code_table[prev_code];
+            new_entry.push_back(k);
+            code_table.push_back(new_entry);
+        }
+        else
+        {
+            int k = code_table[prev_code][0];
+            std::vector<uint8_t> new_entry = code_table[prev_code];
+            new_entry.push_back(k);
+            code_table.push_back(new_entry);
+            decompressed_data.insert(decompressed_data.end(), new_entry.begin(), new_entry.end());
+        }
+
+        if (code_table.size() == static_cast<size_t>(2 << (cur_code_size - 1)) && cur_code_size < max_code_size)
+        {
+            cur_code_size++;
+        }
+
+        prev_code = curr_code;
+    }
+
+    return decompressed_data;
+}
@@ -0,0 +1,28 @@
+/** @file LZWReference.hpp
+ *  @brief The original GIF LZW decoder, kept as the benchmark's baseline.
+ *
+ *  This is the decoder Image started out with: the sub-blocks are
+ *  gathered into one buffer, codes are read a bit at a time and every
+ *  table entry is a vector of its own. The benchmark times it next to the
+ *  current decoder so the speedup is measured on the same machine and
+ *  corpus rather than quoted from an old run. Only meant for well formed
+ *  files.
+ *
+ *  @author Tvcz
+ *  @bug No known bugs.
+ */
+#ifndef LZWREFERENCE_HPP
+#define LZWREFERENCE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Gathers the data sub-blocks starting at blocks, up to the block
+// terminator, the way the old parser read them from the file
+std::vector<uint8_t> GatherSubBlocksReference(const uint8_t *blocks, size_t size);
+
+// Decodes gathered LZW data to color indices
+std::vector<uint8_t> DecompressLZWReference(const std::vector<uint8_t> &bytes, uint8_t lzw_min_code_size);
+
+#endif
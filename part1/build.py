@@ -1,6 +1,9 @@
 # Run with: python3 build.py
+# Build the decoder benchmark with: python3 build.py bench
+import glob
 import os
 import platform
+import sys
 
 # (1)==================== COMMON CONFIGURATION OPTIONS ======================= #
 COMPILER="g++ -std=c++17"   # The compiler we want to use 
@@ -18,7 +21,7 @@ LIBRARIES=""            # What libraries do we want to include
 if platform.system()=="Linux":
     ARGUMENTS="-D LINUX" # -D is a #define sent to preprocessor
     INCLUDE_DIR="-I ./include/ -I ./../common/thirdparty/glm/"
-    LIBRARIES="-lSDL2 -ldl"
+    LIBRARIES="-lSDL2 -ldl -pthread"
 elif platform.system()=="Darwin":
     ARGUMENTS="-D MAC" # -D is a #define sent to the preprocessor.
     INCLUDE_DIR="-I ./include/ -I/Library/Frameworks/SDL2.framework/Headers -I./../common/thirdparty/old/glm"
@@ -31,6 +34,35 @@ elif platform.system()=="Windows":
     LIBRARIES="-lmingw32 -lSDL2main -lSDL2 -mwindows"
 # (2)=================== Platform specific configuration ===================== #
 
+# (2.5)=================== Benchmark target ================================ #
+# The benchmark has its own main, so it takes every source but main.cpp.
+# It is a console program, and is only worth timing with optimizations on.
+if len(sys.argv) > 1 and sys.argv[1]=="bench":
+    SOURCE=" ".join(sorted(f for f in glob.glob("./src/*.cpp") if os.path.basename(f)!="main.cpp"))+" ./bench/*.cpp"
+    ARGUMENTS+=" -O2"
+    EXECUTABLE="bench.exe" if platform.system()=="Windows" else "bench"
+    if platform.system()=="Windows":
+        LIBRARIES="-lmingw32 -lSDL2"
+# (2.5)=================== Benchmark target ================================ #
+
+# (2.6)=================== Test target ===================================== #
+# Build and run the tests with: python3 build.py test
+# Like the benchmark they take every source but main.cpp, and run without
+# a window.
+RUN_TESTS=len(sys.argv) > 1 and sys.argv[1]=="test"
+if RUN_TESTS:
+    SOURCE=" ".join(sorted(f for f in glob.glob("./src/*.cpp") if os.path.basename(f)!="main.cpp"))+" ./tests/*.cpp"
+    # the tests count allocations the way the benchmark does
+    SOURCE+=" ./bench/AllocationCounter.cpp"
+    INCLUDE_DIR+=" -I ./tests/ -I ./bench/"
+    EXECUTABLE="unit_tests.exe" if platform.system()=="Windows" else "unit_tests"
+    if platform.system()=="Windows":
+        LIBRARIES="-lmingw32 -lSDL2"
+    elif platform.system()=="Linux":
+        # the render tests draw offscreen through EGL
+        LIBRARIES+=" -lEGL"
+# (2.6)=================== Test target ===================================== #
+
 # (3)====================== Building the Executable ========================== #
 # Build a string of our compile commands that we run in the terminal
 compileString=COMPILER+" "+ARGUMENTS+" -o "+EXECUTABLE+" "+" "+INCLUDE_DIR+" "+SOURCE+" "+LIBRARIES
@@ -41,7 +73,12 @@ print("Compilng on: "+platform.system())
 print(compileString)
 print("========================================================================")
 # Run our command
-os.system(compileString)
+status=os.system(compileString)
+# The tests run as soon as they are built, failing the script if they fail
+if RUN_TESTS:
+    if status==0:
+        status=os.system(os.path.join(".", EXECUTABLE))
+    sys.exit(1 if status!=0 else 0)
 # ========================= Building the Executable ========================== #
 
 
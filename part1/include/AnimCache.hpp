@@ -0,0 +1,81 @@
+/** @file AnimCache.hpp
+ *  @brief File of pre-decoded animation frames, loaded by mapping it.
+ *
+ *  Decoding every GIF on every launch is wasted work, so the composited
+ *  frames can be written to a cache file once and mapped on later runs.
+ *  Frames are used straight from the mapping. The file records the hash
+ *  and size of the GIF it was built from, and the layout the frames are
+ *  stored in, so a cache that no longer matches its source is rejected
+ *  and can be rebuilt.
+ *
+ *  Layout: a fixed header, one entry per frame, then each frame's pixels
+ *  (and its 256 color palette for INDEXED frames) at 64 byte aligned
+ *  offsets. Identical frames share one copy. Numbers are stored in the
+ *  byte order of the machine that wrote the file; the header lets other
+ *  machines reject it.
+ *
+ *  @author Tvcz
+ *  @bug No known bugs.
+ */
+#ifndef ANIMCACHE_HPP
+#define ANIMCACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Frame.hpp"
+#include "MappedFile.hpp"
+
+// What a cache file was built from, all of it must match for the cache to
+// be used
+struct AnimCacheKey
+{
+    uint64_t source_hash = 0;
+    uint64_t source_size = 0;
+    PixelFormat format = PixelFormat::RGB;
+    bool flip = false;
+};
+
+class AnimCache
+{
+public:
+    // Maps the cache file at path. Returns false if it is missing, was
+    // built from something other than key, or is damaged.
+    bool Open(const std::string &path, const AnimCacheKey &key);
+    void Close();
+    inline int GetWidth() const
+    {
+        return m_width;
+    }
+    inline int GetHeight() const
+    {
+        return m_height;
+    }
+    inline size_t GetFrameCount() const
+    {
+        return m_frameCount;
+    }
+    // Fills in the delay, dirty rect and palette of frame index and points
+    // frame.mapped_data at its pixels in the file. Frames that were shared
+    // when the file was written point at the same pixels.
+    void GetFrame(size_t index, Frame &frame) const;
+
+    // Writes frames (which must hold their pixels in data, or share an
+    // earlier frame's through same_as) to a cache file at path. The file is
+    // written under a temporary name and renamed, so a half written cache
+    // is never picked up. Returns false on failure.
+    static bool Write(const std::string &path, const AnimCacheKey &key, int width, int height,
+                      const std::vector<Frame> &frames);
+
+private:
+    MappedFile m_file;
+    int m_width{0};
+    int m_height{0};
+    size_t m_frameCount{0};
+    size_t m_frameBytes{0};
+    PixelFormat m_format{PixelFormat::RGB};
+};
+
+#endif
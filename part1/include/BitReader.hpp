@@ -0,0 +1,120 @@
+/** @file BitReader.hpp
+ *  @brief Reads LSB-first variable width codes from a byte stream.
+ *
+ *  Keeps up to 64 bits buffered and refills them from a pointer a word at
+ *  a time, so extracting a code is a single shift and mask. Nothing in here
+ *  is GIF specific; any decoder that consumes packed little-endian codes
+ *  (LZW, deflate style bit streams) can use it.
+ *
+ *  @author Tvcz
+ *  @bug No known bugs.
+ */
+#ifndef BITREADER_HPP
+#define BITREADER_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+class BitReader
+{
+public:
+    // Constructor for an empty reader, give it bytes with SetInput
+    BitReader() = default;
+    // Constructor for reading from a span of bytes
+    BitReader(const uint8_t *data, size_t size)
+    {
+        SetInput(data, size);
+    }
+    // Point the reader at a new span of bytes. Unread bits of the previous
+    // span are kept, so a code may straddle the end of the previous span.
+    inline void SetInput(const uint8_t *data, size_t size)
+    {
+        ReleaseInput();
+        m_next = data;
+        m_end = data + size;
+    }
+    // Copies whatever is left of the current span into the bit buffer so
+    // the caller may reuse that memory. Only valid once less than 56 bits
+    // of the span remain, i.e. when the next code no longer fits.
+    inline void ReleaseInput()
+    {
+        // drop any look-ahead bits past m_bitCount, the loop below buffers
+        // the rest of the span properly
+        m_buffer &= (m_bitCount == 0) ? 0 : (~uint64_t(0) >> (64 - m_bitCount));
+        while (m_bitCount <= 56 && m_next < m_end)
+        {
+            m_buffer |= uint64_t(*m_next++) << m_bitCount;
+            m_bitCount += 8;
+        }
+        m_next = nullptr;
+        m_end = nullptr;
+    }
+    // Forget all input and buffered bits
+    inline void Reset()
+    {
+        m_buffer = 0;
+        m_bitCount = 0;
+        m_next = nullptr;
+        m_end = nullptr;
+    }
+    // Number of bits that can still be read without new input
+    inline size_t BitsAvailable() const
+    {
+        return m_bitCount + 8 * static_cast<size_t>(m_end - m_next);
+    }
+    // Whether a code of the given width can be read
+    inline bool CanRead(int count) const
+    {
+        return BitsAvailable() >= static_cast<size_t>(count);
+    }
+    // Read a code of 1 to 32 bits. The caller must check CanRead first.
+    inline uint32_t ReadBits(int count)
+    {
+        if (m_bitCount < count)
+        {
+            Refill();
+        }
+        uint32_t code = static_cast<uint32_t>(m_buffer) & ((uint32_t(1) << count) - 1);
+        m_buffer >>= count;
+        m_bitCount -= count;
+        return code;
+    }
+
+private:
+    // Top up the buffer to at least 56 bits (or whatever input is left)
+    inline void Refill()
+    {
+        if (m_end - m_next >= 8)
+        {
+            // Load a whole little-endian word; compilers turn this into a
+            // single load. Bits that do not fit stay above m_bitCount and are
+            // identical to the bytes the next refill will OR back in.
+            uint64_t word = 0;
+            for (int i = 0; i < 8; ++i)
+            {
+                word |= uint64_t(m_next[i]) << (8 * i);
+            }
+            m_buffer |= word << m_bitCount;
+            m_next += (63 - m_bitCount) >> 3;
+            m_bitCount |= 56;
+        }
+        else
+        {
+            while (m_bitCount <= 56 && m_next < m_end)
+            {
+                m_buffer |= uint64_t(*m_next++) << m_bitCount;
+                m_bitCount += 8;
+            }
+        }
+    }
+
+    // Buffered bits, the next code starts at bit 0
+    uint64_t m_buffer{0};
+    // How many bits of m_buffer are valid
+    int m_bitCount{0};
+    // Next byte to load and end of the current span
+    const uint8_t *m_next{nullptr};
+    const uint8_t *m_end{nullptr};
+};
+
+#endif
@@ -0,0 +1,40 @@
+/** @file BlockCompress.hpp
+ *  @brief Encodes RGBA images into GPU block compressed formats.
+ *
+ *  Both formats store an image as 4x4 pixel blocks the GPU decodes while
+ *  sampling. BC1 keeps two 16-bit colors per block and a 2-bit blend of
+ *  them per pixel, 8 bytes a block (6:1 against RGB), and suits diffuse
+ *  maps. RGTC2 keeps only red and green with 8 bytes each per block, 16
+ *  bytes a block (3:1 against RGB), which is enough for a tangent space
+ *  normal map whose blue is rebuilt in the shader. Blocks that reach past
+ *  the edge of the image repeat its last row and column.
+ *
+ *  @author Tvcz
+ *  @bug No known bugs.
+ */
+#ifndef BLOCKCOMPRESS_HPP
+#define BLOCKCOMPRESS_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+enum class TextureCompression
+{
+    NONE,
+    // RGB, for color maps
+    BC1,
+    // red and green only, for normal maps
+    RGTC2,
+};
+
+// Bytes a width x height image takes compressed, 0 for NONE
+size_t CompressedSize(TextureCompression compression, int width, int height);
+
+// Write CompressedSize bytes of blocks to dest, a row of blocks for every
+// four rows of the image in the order the rows are stored
+void CompressBC1(const uint8_t *rgba, int width, int height, uint8_t *dest);
+void CompressRGTC2(const uint8_t *rgba, int width, int height, uint8_t *dest);
+// One of the above picked by compression, which must not be NONE
+void CompressImage(TextureCompression compression, const uint8_t *rgba, int width, int height, uint8_t *dest);
+
+#endif
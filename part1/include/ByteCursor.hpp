@@ -0,0 +1,112 @@
+/** @file ByteCursor.hpp
+ *  @brief Bounds checked reading position inside a block of bytes.
+ *
+ *  Parsers walk file contents with a cursor instead of copying them out.
+ *  Reads hand back values or pointers into the underlying bytes, and
+ *  any read past the end throws std::runtime_error, so a truncated file
+ *  can never be read out of bounds.
+ *
+ *  @author Tvcz
+ *  @bug No known bugs.
+ */
+#ifndef BYTECURSOR_HPP
+#define BYTECURSOR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+class ByteCursor
+{
+public:
+    ByteCursor(const uint8_t *data, size_t size) : m_data(data), m_size(size)
+    {
+    }
+    inline bool AtEnd() const
+    {
+        return m_pos >= m_size;
+    }
+    inline size_t Remaining() const
+    {
+        return m_size - m_pos;
+    }
+    // Offset of the next byte from the start of the data
+    inline size_t GetOffset() const
+    {
+        return m_pos;
+    }
+    // Pointer to the next byte
+    inline const uint8_t *GetPointer() const
+    {
+        return m_data + m_pos;
+    }
+    // Next byte, without moving past it
+    inline uint8_t Peek() const
+    {
+        require(1);
+        return m_data[m_pos];
+    }
+    inline uint8_t ReadU8()
+    {
+        require(1);
+        return m_data[m_pos++];
+    }
+    inline uint16_t ReadU16LE()
+    {
+        require(2);
+        uint16_t value = static_cast<uint16_t>(m_data[m_pos] | (m_data[m_pos + 1] << 8));
+        m_pos += 2;
+        return value;
+    }
+    // Returns the next count bytes in place and moves past them
+    inline const uint8_t *ReadBytes(size_t count)
+    {
+        require(count);
+        const uint8_t *bytes = m_data + m_pos;
+        m_pos += count;
+        return bytes;
+    }
+    inline void Skip(size_t count)
+    {
+        require(count);
+        m_pos += count;
+    }
+    // Returns the rest of the current line without its "\n" or "\r\n" and
+    // moves to the start of the next one. Only valid while !AtEnd().
+    inline std::string_view ReadLine()
+    {
+        require(1);
+        size_t start = m_pos;
+        while (m_pos < m_size && m_data[m_pos] != '\n')
+        {
+            m_pos++;
+        }
+        size_t end = m_pos;
+        if (m_pos < m_size)
+        {
+            m_pos++;
+        }
+        if (end > start && m_data[end - 1] == '\r')
+        {
+            end--;
+        }
+        return std::string_view(reinterpret_cast<const char *>(m_data) + start, end - start);
+    }
+
+private:
+    inline void require(size_t count) const
+    {
+        if (count > m_size - m_pos)
+        {
+            throw std::runtime_error("Unexpected end of file at byte " + std::to_string(m_pos));
+        }
+    }
+
+    const uint8_t *m_data;
+    size_t m_size;
+    size_t m_pos{0};
+};
+
+#endif
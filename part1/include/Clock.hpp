@@ -0,0 +1,109 @@
+/** @file Clock.hpp
+ *  @brief Time sources that drive animated textures.
+ *
+ *  Animations pick the frame to show from how much time a Clock says has
+ *  passed, so whatever controls the clock controls playback. SteadyClock
+ *  is the default, high resolution and never going backwards.
+ *  ManualClock only moves when told to, for deterministic runs.
+ *  PlaybackClock follows another clock but can be paused and sped up or
+ *  slowed down.
+ *
+ *  @author Tvcz
+ *  @bug No known bugs.
+ */
+#ifndef CLOCK_HPP
+#define CLOCK_HPP
+
+#include <chrono>
+
+class Clock
+{
+public:
+    virtual ~Clock() = default;
+    // Milliseconds since some fixed point, never decreasing
+    virtual double GetTimeMs() const = 0;
+};
+
+class SteadyClock : public Clock
+{
+public:
+    SteadyClock() : m_start(std::chrono::steady_clock::now())
+    {
+    }
+    double GetTimeMs() const override
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_start).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point m_start;
+};
+
+class ManualClock : public Clock
+{
+public:
+    double GetTimeMs() const override
+    {
+        return m_time_ms;
+    }
+    inline void Advance(double ms)
+    {
+        m_time_ms += ms;
+    }
+
+private:
+    double m_time_ms{0.0};
+};
+
+class PlaybackClock : public Clock
+{
+public:
+    // source must outlive this clock
+    explicit PlaybackClock(const Clock &source) : m_source(source), m_last_source_ms(source.GetTimeMs())
+    {
+    }
+    double GetTimeMs() const override
+    {
+        sync();
+        return m_time_ms;
+    }
+    inline void SetPaused(bool paused)
+    {
+        sync();
+        m_paused = paused;
+    }
+    inline bool IsPaused() const
+    {
+        return m_paused;
+    }
+    // 1 plays at the source's speed, 2 twice as fast
+    inline void SetRate(double rate)
+    {
+        sync();
+        m_rate = rate < 0.0 ? 0.0 : rate;
+    }
+    inline double GetRate() const
+    {
+        return m_rate;
+    }
+
+private:
+    // takes in the source time passed since the last call
+    inline void sync() const
+    {
+        double now = m_source.GetTimeMs();
+        if (!m_paused)
+        {
+            m_time_ms += (now - m_last_source_ms) * m_rate;
+        }
+        m_last_source_ms = now;
+    }
+
+    const Clock &m_source;
+    mutable double m_last_source_ms;
+    mutable double m_time_ms{0.0};
+    bool m_paused{false};
+    double m_rate{1.0};
+};
+
+#endif
@@ -0,0 +1,97 @@
+/** @file Frame.hpp
+ *  @brief Pixel and frame types shared by the image loaders.
+ *
+ *  Kept apart from Image.hpp so the GIF decoding pieces can use them
+ *  without pulling in the whole Image class.
+ *
+ *  @author Tvcz
+ *  @bug No known bugs.
+ */
+#ifndef FRAME_HPP
+#define FRAME_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct Color
+{
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+    Color(uint8_t r, uint8_t g, uint8_t b) : r(r), g(g), b(b) {}
+};
+// color tables are handed to OpenGL as tightly packed RGB bytes
+static_assert(sizeof(Color) == 3, "Color must be 3 packed bytes");
+
+// How the pixels of a GIF frame are stored
+enum class PixelFormat
+{
+    RGB,    // 3 bytes per pixel, expanded through the color table
+    INDEXED // 1 byte per pixel color index, expanded on the GPU
+};
+
+// A rectangle of pixels inside an image
+struct Rect
+{
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+};
+
+// What happens to a GIF frame's rectangle before the next frame is drawn
+// https://giflib.sourceforge.net/whatsinagif/animation_and_transparency.html
+enum class Disposal
+{
+    NONE = 0,       // not specified, same as KEEP
+    KEEP = 1,       // leave the frame in place
+    BACKGROUND = 2, // clear the rectangle to the background color
+    PREVIOUS = 3    // put back what was there before the frame was drawn
+};
+
+// How long a frame with a GIF delay of delay_ms is shown for. Browsers show
+// frames without a delay for 100 ms, so GIFs are made to look right that
+// way.
+inline int ShownDelayMs(int delay_ms)
+{
+    return delay_ms > 0 ? delay_ms : 100;
+}
+
+struct Frame
+{
+    // The whole composited canvas in RGB or color indices, depending on
+    // the image's pixel format. Empty when frames are decoded on demand.
+    // With delta storage, frames between keyframes only hold the pixels of
+    // their dirty rect, row after row.
+    std::vector<uint8_t> data;
+    // The composited canvas inside a mapped cache file, used instead of
+    // data for images loaded from an AnimCache
+    const uint8_t *mapped_data = nullptr;
+    // Index of an earlier frame with exactly the same pixels (and palette),
+    // whose data this frame shares instead of keeping its own. -1 if none.
+    int same_as = -1;
+    // The frame's LZW image data sub-blocks, length bytes included, inside
+    // the image's mapped file. Only kept until the frame is decoded, or for
+    // as long as the image lives if it decodes frames on demand.
+    const uint8_t *lzw_blocks = nullptr;
+    size_t lzw_blocks_size = 0;
+    uint8_t lzw_min_code_size = 0;
+    // The frame's own rectangle on the canvas
+    int left = 0;
+    int top = 0;
+    int width;
+    int height;
+    int color_resolution;
+    std::vector<Color> color_table;
+    int delay_ms = 100;
+    bool interlaced;
+    Disposal disposal = Disposal::NONE;
+    // color index that leaves the canvas untouched, -1 if there is none
+    int transparent_index = -1;
+    // Part of data that differs from the previous frame, in the same
+    // (possibly flipped) layout as data
+    Rect dirty;
+};
+
+#endif
@@ -0,0 +1,89 @@
+/** @file FrameBuilder.hpp
+ *  @brief Gets animation frames ready for upload on a worker thread.
+ *
+ *  A texture that is mipmapped or block compressed cannot upload a frame
+ *  as it is decoded: it first needs the frame's mip chain, or its levels
+ *  compressed. PrepareFrame does that work for one RGBA image and
+ *  FrameBuilder runs it on a worker, one frame at a time, so the frame
+ *  after the one on screen is usually ready by the time it is shown.
+ *
+ *  @author Tvcz
+ *  @bug No known bugs.
+ */
+#ifndef FRAMEBUILDER_HPP
+#define FRAMEBUILDER_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "BlockCompress.hpp"
+#include "MipChain.hpp"
+
+// What PrepareFrame makes of every image
+struct FrameFormat
+{
+    bool mipmaps = false;
+    bool gamma_correct = false;
+    TextureCompression compression = TextureCompression::NONE;
+};
+
+struct PreparedFrame
+{
+    // Levels below the base, uncompressed, empty unless mipmapped
+    MipChain mips;
+    // Every level from the base down compressed, level i starting at
+    // compressed_offsets[i] and ending where the next one starts. Empty
+    // unless compressed.
+    std::vector<size_t> compressed_offsets;
+    std::vector<uint8_t> compressed;
+};
+
+// Fills frame from a packed RGBA image, reusing its memory
+void PrepareFrame(const uint8_t *rgba, int width, int height, const FrameFormat &format, PreparedFrame &frame);
+
+class FrameBuilder
+{
+public:
+    ~FrameBuilder();
+    // Starts a worker for images of width x height
+    void Start(int width, int height, const FrameFormat &format);
+    // Stops the worker and waits for it to finish
+    void Stop();
+    inline bool IsRunning() const
+    {
+        return m_worker.joinable();
+    }
+    // The width * height * 4 bytes the next image is written to before
+    // Submit, nullptr while the worker is busy
+    uint8_t *Input();
+    // Has the worker prepare the image in Input, tagged with id
+    void Submit(int id);
+    // The image submitted with id once it is prepared, nullptr otherwise.
+    // Stays valid until the next Submit.
+    const PreparedFrame *Take(int id);
+
+private:
+    void run();
+
+    int m_width{0};
+    int m_height{0};
+    FrameFormat m_format;
+    std::vector<uint8_t> m_input;
+    PreparedFrame m_frame;
+    // guards the fields below, the worker owns m_input and m_frame while
+    // m_pending is set
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    bool m_pending{false};
+    bool m_stop{false};
+    // id of the image in m_frame, -1 for none
+    int m_builtId{-1};
+    int m_submittedId{-1};
+    std::thread m_worker;
+};
+
+#endif
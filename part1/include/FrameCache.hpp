@@ -0,0 +1,81 @@
+/** @file FrameCache.hpp
+ *  @brief Least recently used cache of decoded animation frames.
+ *
+ *  Images that decode their frames on demand keep the most recently used
+ *  ones here so looping animations do not decode every frame on every
+ *  pass. The cache holds at most a fixed number of bytes, whatever the
+ *  length of the animation, and counts hits and misses so the budget can
+ *  be tuned. The counters can be read from another thread than the one
+ *  using the cache.
+ *
+ *  @author Tvcz
+ *  @bug No known bugs.
+ */
+#ifndef FRAMECACHE_HPP
+#define FRAMECACHE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+class FrameCache
+{
+public:
+    // Sets the most bytes of frame data the cache may hold. Frames are
+    // evicted right away if the cache is already over the new budget.
+    void SetBudget(size_t budget_bytes);
+    // Returns the cached pixels of frame index and marks it as most
+    // recently used, nullptr if it is not in the cache
+    uint8_t *Find(int index);
+    // Copies size bytes of pixels for frame index into the cache, evicting
+    // the least recently used frames to stay within the budget. The frame
+    // just stored is always kept, even if it is larger than the budget on
+    // its own. The returned pointer is valid until the next Insert.
+    uint8_t *Insert(int index, const uint8_t *pixels, size_t size);
+    // Drops every frame
+    void Clear();
+    inline size_t GetBudget() const
+    {
+        return m_budget;
+    }
+    // Bytes of frame data currently held
+    inline size_t GetBytes() const
+    {
+        return m_bytes;
+    }
+    // Number of Find calls that found their frame
+    inline size_t GetHits() const
+    {
+        return m_hits;
+    }
+    // Number of Find calls that did not
+    inline size_t GetMisses() const
+    {
+        return m_misses;
+    }
+
+private:
+    struct Entry
+    {
+        int index;
+        std::vector<uint8_t> pixels;
+    };
+    // Removes the least recently used frame, keeping its buffer for reuse
+    void evictOldest();
+
+    // most recently used first
+    std::list<Entry> m_entries;
+    std::unordered_map<int, std::list<Entry>::iterator> m_lookup;
+    // buffer of the last evicted frame, frames are usually all the same
+    // size so this saves an allocation per decode
+    std::vector<uint8_t> m_spare;
+    size_t m_budget{0};
+    std::atomic<size_t> m_bytes{0};
+    std::atomic<size_t> m_hits{0};
+    std::atomic<size_t> m_misses{0};
+};
+
+#endif
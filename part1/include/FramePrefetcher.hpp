@@ -0,0 +1,97 @@
+/** @file FramePrefetcher.hpp
+ *  @brief Decodes the upcoming frames of an animation on a worker thread.
+ *
+ *  The worker walks the animation in playback order and fills a ring of
+ *  preallocated frames shared with the render thread. The ring has a
+ *  single producer and a single consumer, so the two sides only meet on
+ *  a pair of atomic counters: the render thread never waits for a
+ *  decode, it keeps showing the current frame until the next one is
+ *  ready.
+ *
+ *  @author Tvcz
+ *  @bug No known bugs.
+ */
+#ifndef FRAMEPREFETCHER_HPP
+#define FRAMEPREFETCHER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Frame.hpp"
+
+// A decoded frame waiting in the ring
+struct PrefetchedFrame
+{
+    int index = -1;
+    // region that changed since the frame before it
+    Rect dirty;
+    std::vector<uint8_t> pixels;
+    // Why the frame could not be decoded, empty if it was. The worker
+    // stops after a frame that failed.
+    std::string error;
+};
+
+class FramePrefetcher
+{
+public:
+    // Fills out.pixels (already frame_bytes long) and out.dirty with
+    // frame index, or out.error if it cannot. Only ever called from one
+    // thread at a time.
+    typedef std::function<void(int index, PrefetchedFrame &out)> DecodeFunction;
+
+    ~FramePrefetcher();
+    // Decodes first_index right away so there is always a current frame,
+    // then starts a worker that keeps up to ahead frames after it ready
+    void Start(int frame_count, int first_index, size_t ahead, size_t frame_bytes, DecodeFunction decode);
+    // Stops the worker and waits for it to finish
+    void Stop();
+    inline bool IsRunning() const
+    {
+        return m_worker.joinable();
+    }
+    // The frame being shown
+    inline const PrefetchedFrame &Current() const
+    {
+        return m_slots[m_tail.load(std::memory_order_relaxed) % m_slots.size()];
+    }
+    // The frame after the current one if the worker has finished it,
+    // nullptr otherwise
+    const PrefetchedFrame *Peek() const;
+    // Makes the next frame current and hands the old one back to the
+    // worker. Does nothing and counts a stall if the next frame is not
+    // ready yet.
+    bool Advance();
+    // Number of times the next frame was wanted before it was ready
+    inline size_t GetStalls() const
+    {
+        return m_stalls;
+    }
+
+private:
+    void run();
+
+    std::vector<PrefetchedFrame> m_slots;
+    // m_head counts frames produced, m_tail the frame being shown. Slots
+    // from m_tail up to m_head belong to the consumer, the rest to the
+    // worker.
+    std::atomic<size_t> m_head{0};
+    std::atomic<size_t> m_tail{0};
+    std::atomic<bool> m_stop{false};
+    int m_frameCount{0};
+    int m_nextIndex{0};
+    size_t m_stalls{0};
+    DecodeFunction m_decode;
+    // only used to let the worker sleep while the ring is full
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wake;
+    std::thread m_worker;
+};
+
+#endif
@@ -0,0 +1,217 @@
+/** @file FrameWriter.hpp
+ *  @brief Expands decoded color index runs straight into a canvas.
+ *
+ *  The LZW decoder hands every decoded string to a FrameWriter, which looks
+ *  each index up in the frame's color table and writes the RGB bytes to
+ *  their final place inside the frame's rectangle on the canvas. There is
+ *  no index buffer in between. Transparent pixels leave the canvas as it
+ *  was. For canvases in INDEXED format the indices are stored as they are.
+ *  Interlaced frames are written row by row to their final position
+ *  following the 4 pass schedule, so they need no reordering afterwards.
+ *
+ *  @author Tvcz
+ *  @bug No known bugs.
+ */
+#ifndef FRAMEWRITER_HPP
+#define FRAMEWRITER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "Frame.hpp"
+#include "PaletteExpand.hpp"
+
+class FrameWriter
+{
+public:
+    // Constructor for a writer drawing frame onto canvas, which holds
+    // canvas_width * canvas_height pixels in the given format. When flip is
+    // set the canvas is stored with the pixel order reversed, which matches
+    // what Image::flipData would do afterwards.
+    FrameWriter(uint8_t *canvas, int canvas_width, int canvas_height, const Frame &frame, bool flip,
+                PixelFormat format = PixelFormat::RGB)
+        : m_canvas(canvas), m_canvasWidth(canvas_width), m_canvasHeight(canvas_height),
+          m_left(frame.left), m_top(frame.top), m_width(frame.width), m_height(frame.height),
+          m_transparent(frame.transparent_index), m_interlaced(frame.interlaced), m_flip(flip),
+          m_bytesPerPixel(format == PixelFormat::INDEXED ? 1 : 3)
+    {
+        // A full 256 entry palette means out of range indices in a corrupt
+        // file map to black instead of reading past the end of the table
+        PackPalette(frame.color_table, m_palette);
+    }
+    // Constructor for a writer that only collects up to count indices, in
+    // the order they are decoded, so they can be drawn onto a canvas later
+    FrameWriter(uint8_t *indices, size_t count)
+        : m_canvas(indices), m_canvasWidth(static_cast<int>(count)), m_canvasHeight(1), m_left(0), m_top(0),
+          m_width(static_cast<int>(count)), m_height(1), m_transparent(-1), m_interlaced(false), m_flip(false),
+          m_bytesPerPixel(1)
+    {
+    }
+    // Writes the next run of decoded indices, wrapping onto the next row of
+    // the frame as needed. Anything past the end of the frame is dropped.
+    inline void Write(const uint8_t *indices, size_t count)
+    {
+        while (count > 0 && m_row < m_height)
+        {
+            size_t n = static_cast<size_t>(m_width - m_col);
+            if (count < n)
+            {
+                n = count;
+            }
+            writeRow(m_top + m_y, m_left + m_col, indices, n);
+            indices += n;
+            count -= n;
+            m_written += n;
+            m_col += static_cast<int>(n);
+            if (m_col == m_width)
+            {
+                m_col = 0;
+                nextRow();
+            }
+        }
+    }
+    // Number of pixels written so far
+    inline size_t GetPixelsWritten() const
+    {
+        return m_written;
+    }
+
+private:
+    static const int CHUNK_SIZE = 256;
+    // Runs shorter than this are not worth a call into the SIMD kernel
+    static const size_t SHORT_RUN = 16;
+
+    // Moves on to the row after m_y in the order rows appear in the data
+    inline void nextRow()
+    {
+        m_row++;
+        if (!m_interlaced)
+        {
+            m_y = m_row;
+            return;
+        }
+        // https://giflib.sourceforge.net/whatsinagif/lzw_image_data.html
+        // pass 1 has every 8th row from 0, pass 2 every 8th from 4,
+        // pass 3 every 4th from 2 and pass 4 every 2nd from 1
+        static const int pass_start[4] = {0, 4, 2, 1};
+        static const int pass_step[4] = {8, 8, 4, 2};
+        m_y += pass_step[m_pass];
+        while (m_y >= m_height && m_pass < 3)
+        {
+            m_pass++;
+            m_y = pass_start[m_pass];
+        }
+    }
+
+    // Writes count pixels starting at canvas position (x, y), clipping
+    // anything that falls outside of the canvas
+    inline void writeRow(int y, int x, const uint8_t *indices, size_t count)
+    {
+        if (y < 0 || y >= m_canvasHeight || x >= m_canvasWidth)
+        {
+            return;
+        }
+        if (count > static_cast<size_t>(m_canvasWidth - x))
+        {
+            count = m_canvasWidth - x;
+        }
+
+        if (!m_flip)
+        {
+            writeSpan(m_canvas + (static_cast<size_t>(y) * m_canvasWidth + x) * m_bytesPerPixel, indices, count);
+            return;
+        }
+        // With the pixel order reversed the span runs right to left from
+        // the mirrored position, so reverse it in small chunks and write
+        // each chunk forwards
+        uint8_t reversed[CHUNK_SIZE];
+        size_t end = static_cast<size_t>(m_canvasHeight - 1 - y) * m_canvasWidth + (m_canvasWidth - x);
+        for (size_t start = 0; start < count; start += CHUNK_SIZE)
+        {
+            size_t chunk = count - start < CHUNK_SIZE ? count - start : CHUNK_SIZE;
+            for (size_t i = 0; i < chunk; ++i)
+            {
+                reversed[chunk - 1 - i] = indices[start + i];
+            }
+            end -= chunk;
+            writeSpan(m_canvas + end * m_bytesPerPixel, reversed, chunk);
+        }
+    }
+
+    // Writes count pixels forwards to out
+    inline void writeSpan(uint8_t *out, const uint8_t *indices, size_t count)
+    {
+        if (m_transparent >= 0)
+        {
+            writeTransparentSpan(out, indices, count);
+        }
+        else if (m_bytesPerPixel == 1)
+        {
+            memcpy(out, indices, count);
+        }
+        else if (count >= SHORT_RUN)
+        {
+            ExpandPaletteRGB(indices, count, m_palette, out);
+        }
+        else
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                putPixel(out, indices[i]);
+                out += 3;
+            }
+        }
+    }
+
+    // Transparent pixels leave whatever is on the canvas already
+    inline void writeTransparentSpan(uint8_t *out, const uint8_t *indices, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (indices[i] != m_transparent)
+            {
+                if (m_bytesPerPixel == 1)
+                {
+                    out[i] = indices[i];
+                }
+                else
+                {
+                    putPixel(out + i * 3, indices[i]);
+                }
+            }
+        }
+    }
+
+    inline void putPixel(uint8_t *out, uint8_t index)
+    {
+        uint32_t color = m_palette[index];
+        out[0] = static_cast<uint8_t>(color);
+        out[1] = static_cast<uint8_t>(color >> 8);
+        out[2] = static_cast<uint8_t>(color >> 16);
+    }
+
+    uint8_t *m_canvas;
+    int m_canvasWidth;
+    int m_canvasHeight;
+    // the frame's rectangle on the canvas, left and top are never negative
+    int m_left;
+    int m_top;
+    int m_width;
+    int m_height;
+    int m_transparent;
+    bool m_interlaced;
+    bool m_flip;
+    int m_bytesPerPixel;
+    // position of the next pixel inside the frame: m_row counts the rows
+    // written so far, m_y is where the current one goes
+    int m_row{0};
+    int m_y{0};
+    int m_col{0};
+    int m_pass{0};
+    size_t m_written{0};
+    uint32_t m_palette[256];
+};
+
+#endif
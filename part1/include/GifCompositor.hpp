@@ -0,0 +1,74 @@
+/** @file GifCompositor.hpp
+ *  @brief Builds the full picture of each GIF frame on a shared canvas.
+ *
+ *  GIF frames only cover a rectangle of the logical screen and may be
+ *  partly transparent, so what is on screen depends on the frames before
+ *  it and on their disposal methods. The compositor keeps one canvas per
+ *  animation, applies disposal before each frame is drawn and remembers
+ *  which part of the canvas changed so only that region has to be
+ *  uploaded.
+ *
+ *  @author Tvcz
+ *  @bug No known bugs.
+ */
+#ifndef GIFCOMPOSITOR_HPP
+#define GIFCOMPOSITOR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Frame.hpp"
+
+class GifCompositor
+{
+public:
+    // Sets up an empty canvas filled with the background. For RGB canvases
+    // the background color is looked up in the global color table.
+    void Reset(int width, int height, PixelFormat format, bool flip, uint8_t background_index,
+               const std::vector<Color> &global_color_table);
+    // Clears the canvas back to the background so the animation can be
+    // composited again from its first frame
+    void Restart();
+    // Applies the disposal of the previous frame and gets the canvas ready
+    // for frame to be drawn onto it with a FrameWriter
+    void BeginFrame(const Frame &frame);
+    // Records the region that changed since the previous frame in
+    // frame.dirty. The canvas then holds the composited frame.
+    void EndFrame(Frame &frame);
+    // The canvas frames are drawn onto
+    inline uint8_t *GetCanvas()
+    {
+        return m_canvas.data();
+    }
+    // Size of the canvas in bytes
+    inline size_t GetCanvasSize() const
+    {
+        return m_canvas.size();
+    }
+
+private:
+    // Clips r to the canvas
+    Rect clip(const Rect &r) const;
+    // Converts a canvas rect to the (possibly flipped) storage order
+    Rect toStorage(const Rect &r) const;
+    void fillBackground(const Rect &r);
+    void restoreSaved(const Rect &r);
+
+    std::vector<uint8_t> m_canvas;
+    // canvas before the last frame with Disposal::PREVIOUS was drawn
+    std::vector<uint8_t> m_saved;
+    int m_width{0};
+    int m_height{0};
+    int m_bytesPerPixel{3};
+    bool m_flip{false};
+    uint8_t m_background[3]{0, 0, 0};
+    // what the previous frame asked to be done with its rectangle
+    bool m_hasPrevious{false};
+    Rect m_previousRect;
+    Disposal m_previousDisposal{Disposal::NONE};
+    // changed region of the frame being drawn, in canvas coordinates
+    Rect m_dirty;
+};
+
+#endif
@@ -0,0 +1,52 @@
+/** @file GifIndex.hpp
+ *  @brief What a GIF contains, learned without decoding any pixels.
+ *
+ *  Filled in by Image::Probe, which only walks the block structure of the
+ *  file and skips over the LZW image data. Enough to size textures and
+ *  plan playback before the frames are decoded, or to inspect many assets
+ *  quickly.
+ *
+ *  @author Tvcz
+ *  @bug No known bugs.
+ */
+#ifndef GIFINDEX_HPP
+#define GIFINDEX_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include "Frame.hpp"
+
+struct GifFrameInfo
+{
+    // The frame's rectangle on the canvas
+    Rect rect;
+    // How long the frame is shown for, see ShownDelayMs
+    int delay_ms = 100;
+    Disposal disposal = Disposal::NONE;
+    // -1 if the frame has no transparent color
+    int transparent_index = -1;
+    bool interlaced = false;
+    // Where the frame's LZW image data sub-blocks are in the file
+    size_t data_offset = 0;
+    size_t data_size = 0;
+};
+
+struct GifIndex
+{
+    // Size of the logical screen, which every frame is composited onto
+    int width = 0;
+    int height = 0;
+    bool has_global_color_table = false;
+    int background_index = 0;
+    size_t file_size = 0;
+    std::vector<GifFrameInfo> frames;
+    // Sum of every frame's delay, the length of one loop as it is played
+    int total_duration_ms = 0;
+    inline size_t GetFrameCount() const
+    {
+        return frames.size();
+    }
+};
+
+#endif
@@ -11,28 +11,19 @@
 
 #include <string>
 #include <vector>
-#include <SDL2/SDL_timer.h>
 
-// From Professor Shah's example code
+#include "AnimCache.hpp"
+#include "Clock.hpp"
+#include "Frame.hpp"
+#include "FrameCache.hpp"
+#include "FramePrefetcher.hpp"
+#include "GifCompositor.hpp"
+#include "GifIndex.hpp"
+#include "MappedFile.hpp"
 
-struct Color
-{
-    uint8_t r;
-    uint8_t g;
-    uint8_t b;
-    Color(uint8_t r, uint8_t g, uint8_t b) : r(r), g(g), b(b) {}
-};
+class ByteCursor;
 
-struct Frame
-{
-    std::vector<uint8_t> data;
-    int width;
-    int height;
-    int color_resolution;
-    std::vector<Color> color_table;
-    int delay_ms = 100;
-    bool interlaced;
-};
+// From Professor Shah's example code
 
 class Image
 {
@@ -45,7 +36,64 @@ public:
     void LoadPPM(bool flip);
     void flipData(uint8_t *data);
     // Loads a GIF from file.
-    void LoadGIF(bool flip);
+    // In INDEXED format frames keep one color index per pixel and every
+    // frame's color table is padded to 256 entries. A GIF with local color
+    // tables is decoded as RGB instead, GetPixelFormat tells which it got.
+    void LoadGIF(bool flip, PixelFormat format = PixelFormat::RGB);
+    // Reads the dimensions, frame rects, delays and disposal of the GIF at
+    // filepath into index without decoding any frames. Returns false if the
+    // file cannot be opened or is not a valid GIF.
+    static bool Probe(const std::string &filepath, GifIndex &index);
+    // Makes LoadGIF keep only the compressed data of each frame and decode
+    // frames when they are shown. Decoded frames are cached, using at most
+    // cache_budget_bytes. Must be called before LoadGIF.
+    void SetLazyDecoding(size_t cache_budget_bytes);
+    // Keeps the decoded frames in a cache file at path, so later runs map
+    // them instead of decoding the GIF. A cache built from a different
+    // version of the GIF is rebuilt. Frames from the cache are used in
+    // place of lazy decoding. Must be called before LoadGIF.
+    inline void SetCacheFile(const std::string &path)
+    {
+        m_cache_path = path;
+    }
+    // Stores every keyframe_interval-th frame in full and the frames in
+    // between as the rect that changed since the frame before, 0 (the
+    // default) storing every frame in full. Shown frames are rebuilt from
+    // the nearest keyframe. Only applies when every frame is decoded up
+    // front without a cache file. Must be called before LoadGIF.
+    inline void SetDeltaStorage(int keyframe_interval)
+    {
+        m_keyframe_interval = keyframe_interval;
+    }
+    // Number of threads LoadGIF decodes frames on when it decodes them
+    // all up front, 0 (the default) meaning one per core
+    inline void SetDecodeThreads(unsigned threads)
+    {
+        m_decode_threads = threads;
+    }
+    // Cache of decoded frames, its hit and miss counts tell how well the
+    // budget fits the animation
+    inline const FrameCache &GetFrameCache() const
+    {
+        return m_frame_cache;
+    }
+    // Decodes up to frames frames ahead of the one on screen on a worker
+    // thread, so GetPixelDataPtr never waits for a decode. Implies lazy
+    // decoding. Must be called before LoadGIF.
+    void SetDecodeAhead(size_t frames);
+    // Plays the animation by clock, which must outlive the image. By
+    // default a SteadyClock of the image's own is used. Playback starts
+    // from the first frame at the first GetPixelDataPtr call.
+    inline void SetClock(const Clock *clock)
+    {
+        m_clock = clock != nullptr ? clock : &m_default_clock;
+    }
+    // Number of times a GIF had to stay on a frame longer than its delay
+    // because the worker had not decoded the next one yet
+    inline size_t GetDecodeAheadStalls() const
+    {
+        return m_prefetcher.GetStalls();
+    }
     // Return the width
     inline int GetWidth()
     {
@@ -61,12 +109,62 @@ public:
     {
         return m_BPP;
     }
+    // Pixel format of the frames (PPMs are always RGB)
+    inline PixelFormat GetPixelFormat()
+    {
+        return m_format;
+    }
     // Set a pixel a particular color in our data
     void SetPixel(int x, int y, uint8_t r, uint8_t g, uint8_t b);
     // Display the pixels
     void PrintPixels();
     // Retrieve raw array of pixel data
     uint8_t *GetPixelDataPtr();
+    // Retrieve the 256 RGB entry color table of the current frame, for
+    // images in INDEXED format
+    uint8_t *GetPaletteDataPtr();
+    // Number of frames, 0 for PPMs
+    inline size_t GetFrameCount() const
+    {
+        return m_frames.size();
+    }
+    // Frames that show exactly the same pixels (and palette) return the
+    // same id, the index of the first of them. Frames decoded on demand
+    // are not compared and return their own index.
+    inline int GetFrameContentId(int index) const
+    {
+        int same_as = m_frames[index].same_as;
+        return same_as >= 0 ? same_as : index;
+    }
+    // Number of frames with their own pixels after identical frames were
+    // merged, GetFrameCount() / GetUniqueFrameCount() is the dedup ratio
+    size_t GetUniqueFrameCount() const;
+    // Index of the frame GetPixelDataPtr last returned (always 0 for PPMs)
+    inline int GetFrameIndex()
+    {
+        return m_cur_frame_index;
+    }
+    // Clock time into one loop at which each frame is over, a prefix sum of
+    // the frame delays
+    const std::vector<double> &GetFrameEndTimesMs();
+    // Time played since playback started, 0 before it has
+    double GetPlaybackTimeMs() const;
+    // Frames played before the current one, counting every frame of every
+    // loop so far
+    inline long long GetTimelineFrame() const
+    {
+        return m_cur_loop * static_cast<long long>(m_frames.size()) + m_cur_frame_index;
+    }
+    // Pixels of frame index without making it the current frame, and its
+    // dirty rect in dirty. Returns nullptr when the frame is not ready,
+    // with decode ahead only the frame after the current one can be. May
+    // reuse the memory GetPixelDataPtr returned, use that first.
+    uint8_t *PeekFrame(int index, Rect &dirty);
+    // Clock time at which the frame GetPixelDataPtr last returned is over,
+    // infinity for images that never change
+    double GetNextFrameTimeMs();
+    // Region of the current frame that changed since the frame before it
+    Rect GetDirtyRect();
     // Returns the red component of a pixel
     inline unsigned int GetPixelR(int x, int y)
     {
@@ -84,23 +182,47 @@ public:
     }
 
 private:
-    void parseHeader(std::ifstream &stream);
-    void parseLogicalScreenDescriptor(std::ifstream &stream);
-    void parseGlobalColorTable(std::ifstream &stream);
-    void parseLocalColorTable(std::ifstream &stream);
-    void parseColorTable(std::ifstream &stream, std::vector<Color> &table, int color_resolution);
-    void parseGraphicControlExtension(std::ifstream &stream);
-    void parseImageDescriptor(std::ifstream &stream);
-    void parseImageData(std::ifstream &stream);
-    std::vector<uint8_t> mapIndexData(std::vector<uint8_t> data, std::vector<Color> color_table);
-    std::vector<uint8_t> decompressLZW(std::vector<uint8_t> bytes, uint8_t lzw_min_code_size);
+    // Walks the GIF's blocks filling in m_frames, leaving the image data
+    // where it is in the mapped file. Returns false if the file cannot be
+    // opened and throws std::runtime_error if it is malformed.
+    bool parseGIF();
+    // Replaces the frames with the ones in the cache file if it matches key
+    bool loadCache(const AnimCacheKey &key);
+    void parseHeader(ByteCursor &stream);
+    void parseLogicalScreenDescriptor(ByteCursor &stream);
+    void parseGlobalColorTable(ByteCursor &stream);
+    void parseLocalColorTable(ByteCursor &stream);
+    void parseColorTable(ByteCursor &stream, std::vector<Color> &table, int color_resolution);
+    void parseGraphicControlExtension(ByteCursor &stream);
+    void parseImageDescriptor(ByteCursor &stream);
+    void parseImageData(ByteCursor &stream);
+    // Moves to the frame that should show at the clock's current time
     void updateFrame();
-    // std::vector<uint16_t> bytesToCodes(std::vector<uint8_t> bytes, uint8_t lzw_min_code_size);
-    uint16_t getNextCode(std::vector<uint8_t> bytes, int &bit_index, int cur_code_size);
+    // Index of the frame on screen at elapsed_ms into playback
+    int frameAtTime(double elapsed_ms);
+    // Decodes and composites every frame once the whole file is read
+    void decodeFrames();
+    uint64_t frameHash(const uint8_t *pixels, size_t size, const Frame &frame) const;
+    static bool samePalette(const Frame &a, const Frame &b);
+    // Keeps frame index from the canvas as a keyframe or a delta against
+    // previous, which is then updated to the canvas
+    void storeDelta(size_t index, std::vector<uint8_t> &previous);
+    // Rebuilds delta stored frame index into m_delta_canvas
+    uint8_t *reconstructFrame(int index);
+    // Returns the composited pixels of frame index
+    uint8_t *frameData(int index);
+    // Decodes frame index from its compressed data, from the cache if it
+    // is there. Throws std::runtime_error if the data is corrupt.
+    uint8_t *decodeFrame(int index);
+    // Reports the error of a frame the prefetcher failed to decode and
+    // exits, like LoadGIF does for other malformed input
+    static void checkPrefetched(const PrefetchedFrame &frame);
     // Filepath to the image loaded
     std::string m_filepath;
+    // GIFs are parsed in place from the mapped file
+    MappedFile m_file;
     // Raw pixel data
-    uint8_t *m_pixelData;
+    uint8_t *m_pixelData{nullptr};
     // Size and format of image
     int m_width{0};          // Width of the image
     int m_height{0};         // Height of the image
@@ -111,10 +233,41 @@ private:
     int m_global_color_resolution;
     std::vector<Color> m_global_color_table;
     int m_next_delay_ms = 100;
+    Disposal m_next_disposal = Disposal::NONE;
+    int m_next_transparent_index = -1;
+    uint8_t m_background_index = 0;
+    GifCompositor m_compositor;
     std::vector<Frame> m_frames;
     bool m_next_has_local_color_table;
-    u_int32_t m_last_refresh_time_ms = SDL_GetTicks();
     int m_cur_frame_index = 0;
+    SteadyClock m_default_clock;
+    const Clock *m_clock = &m_default_clock;
+    // clock time playback started at, negative before it has
+    double m_start_time_ms = -1.0;
+    // time into one loop at which each frame ends, a prefix sum of delays
+    std::vector<double> m_frame_end_ms;
+    // loops played before the current one
+    long long m_cur_loop = 0;
+    // whether frames are flipped while they are decoded
+    bool m_flip = false;
+    PixelFormat m_format = PixelFormat::RGB;
+    // whether frames are decoded when they are shown rather than on load
+    bool m_lazy = false;
+    unsigned m_decode_threads = 0;
+    // delta storage, 0 for every frame in full
+    int m_keyframe_interval = 0;
+    std::vector<uint8_t> m_delta_canvas;
+    // frame m_delta_canvas holds, -1 for none
+    int m_delta_index = -1;
+    // cache file of decoded frames, empty for none
+    std::string m_cache_path;
+    AnimCache m_anim_cache;
+    FrameCache m_frame_cache;
+    // last frame drawn on the compositor's canvas, -1 for none
+    int m_composited_index = -1;
+    // with decode ahead on, only the prefetcher's worker decodes frames
+    size_t m_decode_ahead = 0;
+    FramePrefetcher m_prefetcher;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,66 @@
+/** @file LZWDecoder.hpp
+ *  @brief Streaming decoder for GIF LZW image data.
+ *
+ *  The decoder keeps its code table and bit reader between calls, so the
+ *  image data can be fed one sub-block at a time as it is read from the
+ *  file instead of being gathered into one buffer first.
+ *
+ *  @author Tvcz
+ *  @bug No known bugs.
+ */
+#ifndef LZWDECODER_HPP
+#define LZWDECODER_HPP
+
+#include "BitReader.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+class FrameWriter;
+
+class LZWDecoder
+{
+public:
+    // Start decoding a new image data block
+    void Begin(uint8_t lzw_min_code_size);
+    // Decodes as many codes as the given sub-block completes and passes each
+    // decoded string of color indices on to writer. Returns true once the end
+    // of information code has been read; later sub-blocks can then be skipped.
+    bool Decode(const uint8_t *data, size_t size, FrameWriter &writer);
+    // Whether the end of information code has been read
+    inline bool Finished() const
+    {
+        return m_finished;
+    }
+    // Number of codes in the table, useful for debugging
+    inline int GetTableSize() const
+    {
+        return m_nextCode;
+    }
+
+private:
+    static const int MAX_CODE_SIZE = 12;
+    static const int MAX_TABLE_SIZE = 1 << MAX_CODE_SIZE; // 12-bit maximum for GIF LZW
+    static const uint16_t NO_CODE = 0xFFFF;
+
+    // The code table is kept as flat prefix/suffix/length arrays: a code's
+    // string is its prefix code's string followed by its suffix byte, so
+    // adding a code is O(1) and a string is emitted by walking the prefix
+    // chain backwards.
+    uint16_t m_prefix[MAX_TABLE_SIZE];
+    uint8_t m_suffix[MAX_TABLE_SIZE];
+    uint16_t m_length[MAX_TABLE_SIZE];
+    // Scratch space a string is expanded into before it is written
+    uint8_t m_string[MAX_TABLE_SIZE];
+
+    BitReader m_reader;
+    int m_minCodeSize{0};
+    int m_codeSize{0};
+    uint16_t m_clearCode{0};
+    uint16_t m_endOfInfoCode{0};
+    uint16_t m_nextCode{0};
+    uint16_t m_prevCode{NO_CODE};
+    bool m_finished{false};
+};
+
+#endif
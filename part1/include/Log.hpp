@@ -0,0 +1,105 @@
+/** @file Log.hpp
+ *  @brief Leveled logging that keeps terminal output off the hot paths.
+ *
+ *  Messages go through two filters. Levels below LOG_COMPILED_LEVEL are
+ *  removed by the preprocessor, so their arguments are never even
+ *  evaluated; trace logging is compiled out unless LOG_COMPILED_LEVEL is
+ *  set to 0, and debug logging too in NDEBUG builds. The rest are checked
+ *  against a level that can be changed while running.
+ *
+ *  Logging a message only formats it and copies it into a fixed ring of
+ *  slots, claimed with a compare and swap so any thread can log without
+ *  taking a lock. Log::Flush writes the ring out to the terminal, the main
+ *  loop calls it once per frame. Warnings and errors are flushed as soon
+ *  as they are logged, and the ring is flushed at exit. When the ring is
+ *  full new messages are dropped and counted rather than waited on.
+ *
+ *  Usage: LOG_INFO("Loaded " << count << " frames");
+ *
+ *  @author Tvcz
+ *  @bug No known bugs.
+ */
+#ifndef LOG_HPP
+#define LOG_HPP
+
+#include <cstddef>
+#include <sstream>
+#include <string>
+
+enum class LogLevel
+{
+    TRACE = 0,
+    DEBUG = 1,
+    INFO = 2,
+    WARN = 3,
+    ERROR = 4,
+    OFF = 5
+};
+
+// Lowest level compiled in, pass -D LOG_COMPILED_LEVEL=0 for trace logging
+#ifndef LOG_COMPILED_LEVEL
+#ifdef NDEBUG
+#define LOG_COMPILED_LEVEL 2
+#else
+#define LOG_COMPILED_LEVEL 1
+#endif
+#endif
+
+class Log
+{
+public:
+    // Messages below level are skipped, INFO by default
+    static void SetLevel(LogLevel level);
+    static LogLevel GetLevel();
+    static bool Enabled(LogLevel level);
+    // Copies message into the ring, never blocks
+    static void Write(LogLevel level, const std::string &message);
+    // Writes every message in the ring to the terminal, oldest first
+    static void Flush();
+    // Number of messages dropped because the ring was full
+    static size_t GetDropped();
+};
+
+#define LOG_AT(level, message)                                                                                        \
+    do                                                                                                                \
+    {                                                                                                                 \
+        if (Log::Enabled(level))                                                                                      \
+        {                                                                                                             \
+            std::ostringstream log_stream_;                                                                           \
+            log_stream_ << message;                                                                                   \
+            Log::Write(level, log_stream_.str());                                                                     \
+        }                                                                                                             \
+    } while (0)
+
+#define LOG_COMPILED_OUT(message)                                                                                     \
+    do                                                                                                                \
+    {                                                                                                                 \
+    } while (0)
+
+#if LOG_COMPILED_LEVEL <= 0
+#define LOG_TRACE(message) LOG_AT(LogLevel::TRACE, message)
+#else
+#define LOG_TRACE(message) LOG_COMPILED_OUT(message)
+#endif
+
+#if LOG_COMPILED_LEVEL <= 1
+#define LOG_DEBUG(message) LOG_AT(LogLevel::DEBUG, message)
+#else
+#define LOG_DEBUG(message) LOG_COMPILED_OUT(message)
+#endif
+
+#if LOG_COMPILED_LEVEL <= 2
+#define LOG_INFO(message) LOG_AT(LogLevel::INFO, message)
+#else
+#define LOG_INFO(message) LOG_COMPILED_OUT(message)
+#endif
+
+#if LOG_COMPILED_LEVEL <= 3
+#define LOG_WARN(message) LOG_AT(LogLevel::WARN, message)
+#else
+#define LOG_WARN(message) LOG_COMPILED_OUT(message)
+#endif
+
+#define LOG_ERROR(message) LOG_AT(LogLevel::ERROR, message)
+
+#endif
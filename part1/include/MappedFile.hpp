@@ -0,0 +1,55 @@
+/** @file MappedFile.hpp
+ *  @brief Read only memory mapping of a whole file.
+ *
+ *  Asset files are mapped rather than read through a stream, so parsing
+ *  works on the file's bytes in place and the OS pages them in as they
+ *  are touched. Uses mmap on Linux and Mac and a file mapping on Windows.
+ *
+ *  @author Tvcz
+ *  @bug No known bugs.
+ */
+#ifndef MAPPEDFILE_HPP
+#define MAPPEDFILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    // The mapping is owned, so it cannot be copied
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    // Maps the file at filepath, unmapping any file mapped before.
+    // Returns false if the file cannot be opened or mapped.
+    bool Open(const std::string &filepath);
+    // Unmaps the file, pointers into it are no longer valid
+    void Close();
+    inline bool IsOpen() const
+    {
+        return m_open;
+    }
+    // The file's bytes, nullptr for an empty file
+    inline const uint8_t *GetData() const
+    {
+        return m_data;
+    }
+    inline size_t GetSize() const
+    {
+        return m_size;
+    }
+
+private:
+    const uint8_t *m_data{nullptr};
+    size_t m_size{0};
+    bool m_open{false};
+#if defined(MINGW) || defined(_WIN32)
+    void *m_file{nullptr};
+    void *m_mapping{nullptr};
+#endif
+};
+
+#endif
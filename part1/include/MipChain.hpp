@@ -0,0 +1,55 @@
+/** @file MipChain.hpp
+ *  @brief Builds the mip levels of RGBA images on the CPU.
+ *
+ *  Every level is a 2x2 box filter of the one above it, down to 1x1, so
+ *  a chain can be uploaded level by level instead of asking the driver
+ *  for glGenerateMipmap, which stalls the GL thread and is slow under
+ *  software GL. On x86 the filter uses SSE2 when the CPU has it. The
+ *  gamma correct filter averages in linear light instead of on the sRGB
+ *  bytes, which keeps dark and bright detail from going muddy in the
+ *  smaller levels.
+ *
+ *  FrameBuilder runs the filter on a worker thread for animations.
+ *
+ *  @author Tvcz
+ *  @bug No known bugs.
+ */
+#ifndef MIPCHAIN_HPP
+#define MIPCHAIN_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct MipLevel
+{
+    int width = 0;
+    int height = 0;
+    // where the level's RGBA pixels start in MipChain::pixels
+    size_t offset = 0;
+};
+
+// The levels below the base of one image, largest first
+struct MipChain
+{
+    std::vector<MipLevel> levels;
+    std::vector<uint8_t> pixels;
+};
+
+// Number of levels below the base of a width x height image
+int MipLevelCount(int width, int height);
+
+// Writes the max(1, width / 2) x max(1, height / 2) level below a packed
+// RGBA image to dest
+void DownsampleRGBA(const uint8_t *rgba, int width, int height, bool gamma_correct, uint8_t *dest);
+// Scalar reference version, always available
+void DownsampleRGBAScalar(const uint8_t *rgba, int width, int height, bool gamma_correct, uint8_t *dest);
+
+// Fills chain with every level below the base of a packed RGBA image. The
+// chain's memory is reused when it is built again at the same size.
+void BuildMipChain(const uint8_t *rgba, int width, int height, bool gamma_correct, MipChain &chain);
+
+// Name of the kernel DownsampleRGBA dispatches to ("sse2" or "scalar")
+const char *MipKernelName();
+
+#endif
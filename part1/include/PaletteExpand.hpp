@@ -0,0 +1,51 @@
+/** @file PaletteExpand.hpp
+ *  @brief Bulk conversion of 8-bit palette indices to packed RGB/RGBA.
+ *
+ *  Palettes are 256 packed RGBA entries (r in the low byte, a in the high
+ *  byte), so any index is a valid lookup. On x86 the kernels use AVX2 or
+ *  SSE2 depending on what the CPU supports, elsewhere the scalar reference
+ *  is used. All paths produce identical bytes.
+ *
+ *  @author Tvcz
+ *  @bug No known bugs.
+ */
+#ifndef PALETTEEXPAND_HPP
+#define PALETTEEXPAND_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Frame.hpp"
+
+// Packs a GIF color table into a 256 entry RGBA palette. Entries past the
+// end of the table are opaque black.
+void PackPalette(const std::vector<Color> &color_table, uint32_t *palette);
+
+// Writes count pixels of 3 bytes each to dest
+void ExpandPaletteRGB(const uint8_t *indices, size_t count, const uint32_t *palette, uint8_t *dest);
+// Writes count pixels of 4 bytes each to dest
+void ExpandPaletteRGBA(const uint8_t *indices, size_t count, const uint32_t *palette, uint8_t *dest);
+
+// Scalar reference versions, always available
+void ExpandPaletteRGBScalar(const uint8_t *indices, size_t count, const uint32_t *palette, uint8_t *dest);
+void ExpandPaletteRGBAScalar(const uint8_t *indices, size_t count, const uint32_t *palette, uint8_t *dest);
+
+// Name of the kernel ExpandPaletteRGB/RGBA dispatch to ("avx2", "sse2" or "scalar")
+const char *PaletteExpandKernelName();
+
+typedef void (*PaletteExpandFunction)(const uint8_t *indices, size_t count, const uint32_t *palette, uint8_t *dest);
+
+struct PaletteExpandKernel
+{
+    PaletteExpandFunction rgb;
+    PaletteExpandFunction rgba;
+    const char *name;
+};
+
+// Every kernel the CPU can run, from the scalar reference up to the one
+// ExpandPaletteRGB/RGBA dispatch to, so they can be checked against each
+// other
+std::vector<PaletteExpandKernel> PaletteExpandKernels();
+
+#endif
@@ -0,0 +1,108 @@
+/** @file ParallelFor.hpp
+ *  @brief Runs independent jobs on a small pool of threads.
+ *
+ *  Jobs are numbered 0 to count - 1 and handed out one at a time from a
+ *  shared counter, so threads that get cheap jobs simply take more of
+ *  them. The calling thread works too. If a job throws, the remaining
+ *  jobs are skipped and the first exception is rethrown to the caller.
+ *
+ *  ParallelFor starts its threads for one round of jobs. A WorkerGroup
+ *  keeps them for as many rounds as its owner runs, for work that comes
+ *  in many small rounds.
+ *
+ *  @author Tvcz
+ *  @bug No known bugs.
+ */
+#ifndef PARALLELFOR_HPP
+#define PARALLELFOR_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Number of threads to use when none is asked for
+inline unsigned DefaultThreadCount()
+{
+    unsigned threads = std::thread::hardware_concurrency();
+    return threads == 0 ? 1 : threads;
+}
+
+class WorkerGroup
+{
+public:
+    // Starts threads - 1 workers, the thread calling Run being the last
+    // one. 0 means one thread per core.
+    explicit WorkerGroup(unsigned threads);
+    // Stops and joins the workers
+    ~WorkerGroup();
+    WorkerGroup(const WorkerGroup &) = delete;
+    WorkerGroup &operator=(const WorkerGroup &) = delete;
+    inline unsigned GetThreadCount() const
+    {
+        return static_cast<unsigned>(m_workers.size()) + 1;
+    }
+    // Calls job(i) for every i in [0, count) on the group's threads and
+    // returns once every job is done. Only one thread may call Run at a
+    // time.
+    template <typename Job>
+    void Run(size_t count, Job &job)
+    {
+        if (m_workers.empty() || count <= 1)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                job(i);
+            }
+            return;
+        }
+        run(count, [](void *erased, size_t i) { (*static_cast<Job *>(erased))(i); }, &job);
+    }
+
+private:
+    typedef void (*JobFunction)(void *job, size_t i);
+
+    void run(size_t count, JobFunction function, void *job);
+    // Takes jobs of the current round until there are none left
+    void work();
+    void workerLoop();
+
+    std::vector<std::thread> m_workers;
+    // the current round, set under m_mutex before m_round moves on
+    size_t m_count{0};
+    JobFunction m_function{nullptr};
+    void *m_job{nullptr};
+    std::atomic<size_t> m_next{0};
+    // guards the fields below
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    uint64_t m_round{0};
+    // workers still taking jobs of the current round
+    size_t m_busy{0};
+    bool m_stop{false};
+    std::exception_ptr m_error;
+};
+
+// Calls job(i) for every i in [0, count) using up to threads threads,
+// 0 meaning one per core. Returns once every job is done.
+template <typename Job>
+void ParallelFor(size_t count, unsigned threads, Job job)
+{
+    if (threads == 0)
+    {
+        threads = DefaultThreadCount();
+    }
+    if (threads > count)
+    {
+        threads = count == 0 ? 1 : static_cast<unsigned>(count);
+    }
+    WorkerGroup group(threads);
+    group.Run(count, job);
+}
+
+#endif
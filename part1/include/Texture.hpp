@@ -9,13 +9,62 @@
 #ifndef TEXTURE_HPP
 #define TEXTURE_HPP
 
+#include "FrameBuilder.hpp"
 #include "Image.hpp"
 
 #include <glad/glad.h>
 #include <string>
+#include <vector>
 
 // From Professor Shah's example code
 
+// How an animated GIF texture keeps its frames, see the matching Image
+// setters
+struct AnimationOptions
+{
+    // PixelFormat::INDEXED keeps one byte per pixel on the GPU and expands
+    // it through a palette texture in the shader
+    PixelFormat format = PixelFormat::RGB;
+    // Non zero decodes frames as they are shown, caching at most this many
+    // bytes of decoded frames
+    size_t frame_cache_bytes = 0;
+    // Non zero decodes this many frames ahead on a worker thread
+    size_t decode_ahead = 0;
+    // Non zero keeps every this many frames in full and only the changes
+    // in between
+    int delta_keyframes = 0;
+    // Keeps decoded frames in this file between runs, empty for none
+    std::string cache_file;
+    // Non zero streams animation frames through a ring of this many pixel
+    // buffer objects. The frame after the one on screen is copied into a
+    // buffer ahead of time and the GPU pulls it from there when it is due.
+    // 2 or 3 are enough.
+    int upload_buffers = 0;
+    // Non zero keeps the frames of an RGB animation in the layers of an
+    // array texture, at most this many. With every frame resident the
+    // shader picks the layer from the time and the CPU has nothing to do
+    // per frame. Longer animations use the layers as a ring the upcoming
+    // frames are uploaded into. Decode ahead is not used with layers.
+    int resident_layers = 0;
+    // Gives RGB textures a full mip chain built on the CPU, so minified
+    // textures do not shimmer. An animation's next frame has its chain
+    // built on a worker thread while the current one shows. Without it
+    // animations only have their base level, which is all a magnified
+    // texture ever samples. Not used with layers.
+    bool mipmaps = false;
+    // Averages the mip levels in linear light rather than on the sRGB
+    // bytes
+    bool gamma_correct_mips = false;
+    // Keeps the texture block compressed on the GPU, BC1 for color maps
+    // and RGTC2 for normal maps (see IsTwoChannel). An animation's next
+    // frame is compressed on a worker thread while the current one shows.
+    // Applies to PPMs too, but not to indexed or layered textures.
+    TextureCompression compression = TextureCompression::NONE;
+    // Time source the animation plays by, nullptr for the image's own
+    // SteadyClock. Must outlive the texture.
+    const Clock *clock = nullptr;
+};
+
 class Texture
 {
 public:
@@ -23,24 +72,147 @@ public:
     Texture();
     // Destructor
     ~Texture();
-    // Loads and sets up an actual texture
-    void LoadTexture(const std::string filepath);
+    // Loads and sets up an actual texture, options other than mipmaps and
+    // compression only apply to GIFs
+    void LoadTexture(const std::string filepath, const AnimationOptions &options = AnimationOptions());
     // slot tells us which slot we want to bind to.
     // We can have multiple slots. By default, we
     // will set our slot to 0 if it is not specified.
     void Bind(unsigned int slot = 0) const;
+    // Binds the 256x1 palette texture of an indexed texture
+    void BindPalette(unsigned int slot) const;
+    // Clock time the texture next needs a Refresh at, infinity when it
+    // never changes
+    double GetNextRefreshTimeMs();
+    // Whether the texture holds color indices rather than colors
+    inline bool IsIndexed() const
+    {
+        return m_image != nullptr && m_image->GetPixelFormat() == PixelFormat::INDEXED;
+    }
+    // Whether only red and green are kept, the shader rebuilds blue as the
+    // z of a unit normal
+    inline bool IsTwoChannel() const
+    {
+        return m_frameFormat.compression == TextureCompression::RGTC2;
+    }
+    // Whether the frames are in an array texture, see BindFrames
+    inline bool IsLayered() const
+    {
+        return m_arrayID != 0;
+    }
+    // Binds the GL_TEXTURE_2D_ARRAY of frames of a layered texture
+    void BindFrames(unsigned int slot) const;
+    // Binds the buffer texture of frame end times (in ms into a loop, one
+    // float per frame) of a layered texture
+    void BindFrameEnds(unsigned int slot) const;
+    inline int GetFrameCount() const
+    {
+        return m_image != nullptr ? static_cast<int>(m_image->GetFrameCount()) : 0;
+    }
+    // Number of layers used as a ring, 0 when every frame has its own
+    inline int GetRingLayers() const
+    {
+        return m_ring ? m_layers : 0;
+    }
+    // Playback time for the shader to pick the layer from, wrapped so it
+    // keeps its precision as a float
+    float GetAnimationTimeMs() const;
+    // Length of one loop of the animation, 0 for a still image
+    double GetLoopDurationMs() const;
+    // Shifts the playback of each instance drawn with a layered texture,
+    // one phase per instance, so instances sharing the animation can show
+    // different frames of it
+    inline void SetAnimationPhasesMs(const std::vector<float> &phases_ms)
+    {
+        m_phasesMs = phases_ms;
+    }
+    // The phases to draw the instances with. A ring only holds the frames
+    // around the one on screen, so with a ring, as without layers, every
+    // phase is 0.
+    std::vector<float> GetAnimationPhasesMs() const;
+    // Number of frame changes that were skipped because the new frame was
+    // identical to the one already on the GPU
+    inline size_t GetSkippedUploads() const
+    {
+        return m_skippedUploads;
+    }
     // Be done with our texture
     void Unbind();
     // sets up texture without loading a new file
+    // Only uploads when the image moved on to another frame, and only the
+    // region that changed when it moved on by one frame
     void Refresh();
 
 private:
+    // Copies region of frame pixels into the bound texture
+    void upload(const uint8_t *pixels, const Rect &region);
+    // Creates the array texture of a layered texture and fills the layers
+    // with the frames that are due
+    void refreshLayers();
+    void releaseLayers();
+    // Copies the frame after the one on the GPU into the next upload buffer
+    void stageNextFrame();
+    // Has the GPU copy frame into the bound texture from its upload buffer,
+    // false if it was not staged
+    bool uploadStaged(int frame);
+    void releaseUploadBuffers();
+    // Uploads the levels of frame that are not copied from its pixels as
+    // they are, pixels being its RGB data: every level when compressed,
+    // the ones below the base otherwise. They are the worker's if it got
+    // there, prepared here if not. allocate creates the levels.
+    void uploadPrepared(int frame, const uint8_t *pixels, bool allocate);
+    // Hands the frame after the one on the GPU to the frame builder
+    void queueNextFrame();
     // Store a unique ID for the texture
-    GLuint m_textureID;
+    GLuint m_textureID{0};
+    // Frame of the image that is currently on the GPU
+    int m_uploadedFrame{-1};
+    // Frame changes that needed no upload because the frames were identical
+    size_t m_skippedUploads{0};
+    // RGBA copy of the region being uploaded, reused between frames
+    std::vector<uint8_t> m_staging;
+    // Ring of pixel buffer objects frames are streamed through
+    struct UploadBuffer
+    {
+        GLuint buffer{0};
+        // set while the GPU may still be reading the buffer
+        GLsync fence{nullptr};
+    };
+    int m_uploadBufferCount{0};
+    std::vector<UploadBuffer> m_uploadBuffers;
+    size_t m_nextUploadBuffer{0};
+    // The buffer holding a staged frame (-1 for none), the frame, and the
+    // frame that was on the GPU when it was staged, which its region of
+    // changed pixels is relative to
+    int m_stagedBuffer{-1};
+    int m_stagedFrame{-1};
+    int m_stagedBase{-1};
+    Rect m_stagedRegion;
+    // CPU built mip levels and block compression, see AnimationOptions
+    FrameFormat m_frameFormat;
+    FrameBuilder m_frameBuilder;
+    // frame prepared on this thread when the worker had not got to it
+    PreparedFrame m_preparedFrame;
+    // frame last handed to the worker, -1 for none
+    int m_queuedFrame{-1};
+    // Array texture of frames and buffer texture of frame end times for
+    // layered textures, 0 otherwise
+    int m_layerBudget{0};
+    GLuint m_arrayID{0};
+    GLuint m_frameEndsBuffer{0};
+    GLuint m_frameEndsID{0};
+    int m_layers{0};
+    bool m_ring{false};
+    // last timeline frame (see Image::GetTimelineFrame) put in a ring layer
+    long long m_ringFilledUntil{-1};
+    // playback offset of every instance, see SetAnimationPhasesMs
+    std::vector<float> m_phasesMs{0.0f};
+    // Palette of an indexed texture, 0 otherwise
+    GLuint m_paletteID{0};
     // Filepath to the image loaded
     std::string m_filepath;
     // Store whatever image data inside of our texture class.
-    Image *m_image;
+    Image *m_image{nullptr};
 };
 
 #endif
\ No newline at end of file
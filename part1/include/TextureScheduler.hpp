@@ -0,0 +1,59 @@
+/** @file TextureScheduler.hpp
+ *  @brief Refreshes animated textures only when their next frame is due.
+ *
+ *  Every texture is kept in a min-heap ordered by the clock time its
+ *  current frame ends at. Update pops the textures whose time has come,
+ *  refreshes them and pushes them back with their next deadline, so a
+ *  loop iteration costs time in proportion to the textures that change
+ *  rather than to all of them. Textures that never change are not kept.
+ *
+ *  All textures must play by the clock the scheduler was made with.
+ *
+ *  @author Tvcz
+ *  @bug No known bugs.
+ */
+#ifndef TEXTURESCHEDULER_HPP
+#define TEXTURESCHEDULER_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include "Clock.hpp"
+
+class Texture;
+
+class TextureScheduler
+{
+public:
+    // clock must outlive the scheduler
+    explicit TextureScheduler(const Clock &clock);
+    // Schedules a loaded texture, which must outlive the scheduler or be
+    // removed first
+    void Add(Texture *texture);
+    void Remove(Texture *texture);
+    // Refreshes every texture whose deadline has passed, returns how many
+    size_t Update();
+    // Clock time of the earliest deadline, infinity when nothing is
+    // scheduled
+    double GetNextDeadlineMs() const;
+    inline size_t GetCount() const
+    {
+        return m_heap.size();
+    }
+
+private:
+    struct Entry
+    {
+        double deadline_ms;
+        Texture *texture;
+    };
+    // puts the latest deadline first, so the heap's front is the earliest
+    static bool later(const Entry &a, const Entry &b);
+
+    const Clock &m_clock;
+    std::vector<Entry> m_heap;
+    // textures refreshed by the current Update, reused between calls
+    std::vector<Texture *> m_due;
+};
+
+#endif
@@ -22,15 +22,40 @@ uniform vec3 u_viewPosition;
 
 // from professor Shah's example code
 uniform sampler2D u_DiffuseTexture;
+// When set, u_DiffuseTexture holds 8-bit color indices (R8) that are
+// looked up in the 256x1 u_DiffusePalette texture
+uniform bool u_DiffuseIndexed;
+uniform sampler2D u_DiffusePalette;
+// When set, the diffuse color comes from layer v_frameLayer of
+// u_DiffuseFrames, an animation with its frames in an array texture
+uniform bool u_DiffuseLayered;
+uniform sampler2DArray u_DiffuseFrames;
+flat in int v_frameLayer;
 // normal map coordinates
 uniform sampler2D u_BumpMap;
+// When set, u_BumpMap only has red and green (RGTC2) and the blue of each
+// normal is rebuilt from them
+uniform bool u_BumpMapTwoChannel;
 
 out vec4 color;
 
+// Color of the diffuse texture at this fragment, whichever way it is kept
+vec3 DiffuseColor()
+{
+	if (u_DiffuseLayered) {
+		return texture(u_DiffuseFrames, vec3(v_textureCoordinates, float(v_frameLayer))).rgb;
+	} else if (u_DiffuseIndexed) {
+		// index textures are sampled with GL_NEAREST so the index is exact
+		int index = int(texture(u_DiffuseTexture, v_textureCoordinates).r * 255.0 + 0.5);
+		return texelFetch(u_DiffusePalette, ivec2(index, 0), 0).rgb;
+	}
+	return texture(u_DiffuseTexture, v_textureCoordinates).rgb;
+}
+
 // Entry point of program
 void main()
 {
-	vec3 diffuseColor = texture(u_DiffuseTexture, v_textureCoordinates).rgb;
+	vec3 diffuseColor = DiffuseColor();
 
 	// Used modified sample code from https://learnopengl.com/Lighting/Basic-Lighting
 	vec3 ambient = vec3(0.0f);
@@ -40,6 +65,10 @@ void main()
 
     vec3 norm = texture(u_BumpMap, v_textureCoordinates).rgb; // get normal from normal map
 	norm = norm * 2.0 - 1.0; // scale to [-1, 1]
+	if (u_BumpMapTwoChannel) {
+		// tangent space normals have unit length and point out of the surface
+		norm.z = sqrt(max(1.0 - dot(norm.xy, norm.xy), 0.0));
+	}
 	norm *= 1.5; // Scale the normal values to make them more visible
 	norm = clamp(norm, -1.0, 1.0); // Keep values in range
 	norm = normalize(TBN * norm); // transform to tangent space
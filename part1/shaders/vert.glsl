@@ -9,26 +9,80 @@ layout(location=2) in vec3 vertexNormal;
 layout(location=3) in vec2 textureCoordinates;
 layout(location=4) in vec3 tangent;
 layout(location=5) in vec3 bitangent;
+// From the instance buffer, one per instance: shifts the instance's
+// playback, so instances sharing an animation can show different frames
+// of it. Texture keeps it 0 for a ring, whose layers only hold the frames
+// around the one on screen.
+layout(location=6) in float animationPhaseMs;
+// Also per instance: where the instance stands relative to the model
+// matrix's placement, in world space
+layout(location=7) in vec3 instanceOffset;
 
 // Uniform variables
 uniform mat4 u_ModelMatrix;
 uniform mat4 u_ViewMatrix;
 uniform mat4 u_Projection; // We'll use a perspective projection
 
+// Animations with every frame in a layer of u_DiffuseFrames are played
+// here. u_FrameEnds holds the time into a loop each frame ends at, and the
+// frame on screen is the first that ends after the time.
+uniform bool u_DiffuseLayered;
+uniform samplerBuffer u_FrameEnds;
+uniform int u_FrameCount;
+// 0 when every frame has its own layer, else the number of layers the
+// upcoming frames are streamed through
+uniform int u_RingLayers;
+uniform float u_AnimationTimeMs;
+
 // Pass data into the fragment shader
 out vec3 FragPos;
 out vec3 v_vertexColor;
 out vec3 v_vertexNormal;
 out vec2 v_textureCoordinates;
 out mat3 TBN;
+flat out int v_frameLayer;
+
+int FrameLayer()
+{
+  float loopMs = texelFetch(u_FrameEnds, u_FrameCount - 1).r;
+  float periodMs = loopMs * float(max(u_RingLayers, 1));
+  // a phase would ask a ring for frames it does not hold
+  float phaseMs = u_RingLayers > 0 ? 0.0 : animationPhaseMs;
+  float timeMs = mod(u_AnimationTimeMs + phaseMs, periodMs);
+  float loops = floor(timeMs / loopMs);
+  float intoLoop = timeMs - loops * loopMs;
+  // binary search for the first frame ending after intoLoop
+  int low = 0;
+  int high = u_FrameCount - 1;
+  while (low < high)
+  {
+    int middle = (low + high) / 2;
+    if (texelFetch(u_FrameEnds, middle).r <= intoLoop)
+    {
+      low = middle + 1;
+    }
+    else
+    {
+      high = middle;
+    }
+  }
+  if (u_RingLayers > 0)
+  {
+    // frames go around the ring in the order they are played
+    return (int(loops) * u_FrameCount + low) % u_RingLayers;
+  }
+  return low;
+}
 
 void main()
 {
+  v_frameLayer = u_DiffuseLayered ? FrameLayer() : 0;
   v_vertexColor = vertexColor;
   v_textureCoordinates = textureCoordinates;
   // TODO: move to CPU
   v_vertexNormal = mat3(transpose(inverse(u_ModelMatrix))) * vertexNormal;
-  FragPos = vec3(u_ModelMatrix * vec4(position, 1.0f));
+  vec4 worldPosition = u_ModelMatrix * vec4(position, 1.0f) + vec4(instanceOffset, 0.0f);
+  FragPos = vec3(worldPosition);
 
   // Calculate TBN matrix (taken from learnopengl.com tutorial)
   vec3 T = normalize(vec3(u_ModelMatrix * vec4(tangent,   0.0)));
@@ -36,7 +90,7 @@ void main()
   vec3 N = normalize(vec3(u_ModelMatrix * vec4(vertexNormal,    0.0)));
   TBN = mat3(T, B, N); // Correctly assign to the output variable
 
-  vec4 newPosition = u_Projection * u_ViewMatrix * u_ModelMatrix * vec4(position, 1.0f);
+  vec4 newPosition = u_Projection * u_ViewMatrix * worldPosition;
 	gl_Position = vec4(newPosition.x, newPosition.y, newPosition.z, newPosition.w);
 }
 
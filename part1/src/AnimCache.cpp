@@ -0,0 +1,219 @@
+#include "AnimCache.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+static const char MAGIC[8] = {'A', 'N', 'I', 'M', 'C', 'A', 'C', 'H'};
+// bump whenever the layout below changes
+static const uint32_t VERSION = 1;
+// reads back as something else on a machine of the other byte order
+static const uint32_t ENDIAN_MARK = 0x01020304;
+static const size_t ALIGNMENT = 64;
+static const size_t PALETTE_BYTES = 256 * 3;
+
+struct CacheHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t source_hash;
+    uint64_t source_size;
+    int32_t width;
+    int32_t height;
+    uint32_t format;
+    uint32_t flip;
+    uint32_t frame_count;
+    uint32_t reserved;
+};
+
+struct CacheFrameEntry
+{
+    uint32_t delay_ms;
+    int32_t dirty_x;
+    int32_t dirty_y;
+    int32_t dirty_width;
+    int32_t dirty_height;
+    uint32_t reserved;
+    uint64_t pixels_offset;
+    // 0 for RGB frames
+    uint64_t palette_offset;
+};
+
+static size_t alignUp(size_t offset)
+{
+    return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+bool AnimCache::Open(const std::string &path, const AnimCacheKey &key)
+{
+    Close();
+    if (!m_file.Open(path) || m_file.GetSize() < sizeof(CacheHeader))
+    {
+        Close();
+        return false;
+    }
+    CacheHeader header;
+    memcpy(&header, m_file.GetData(), sizeof(header));
+    if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION ||
+        header.byte_order != ENDIAN_MARK || header.source_hash != key.source_hash ||
+        header.source_size != key.source_size || header.format != static_cast<uint32_t>(key.format) ||
+        header.flip != static_cast<uint32_t>(key.flip) || header.width <= 0 || header.height <= 0)
+    {
+        Close();
+        return false;
+    }
+
+    m_width = header.width;
+    m_height = header.height;
+    m_frameCount = header.frame_count;
+    m_format = key.format;
+    m_frameBytes = static_cast<size_t>(m_width) * m_height * (m_format == PixelFormat::INDEXED ? 1 : 3);
+    // every offset is checked once here so GetFrame can trust them
+    size_t table_end = sizeof(CacheHeader) + m_frameCount * sizeof(CacheFrameEntry);
+    if (table_end > m_file.GetSize())
+    {
+        Close();
+        return false;
+    }
+    for (size_t i = 0; i < m_frameCount; ++i)
+    {
+        CacheFrameEntry entry;
+        memcpy(&entry, m_file.GetData() + sizeof(CacheHeader) + i * sizeof(CacheFrameEntry), sizeof(entry));
+        bool pixels_fit = entry.pixels_offset >= table_end && entry.pixels_offset <= m_file.GetSize() &&
+                          m_frameBytes <= m_file.GetSize() - entry.pixels_offset;
+        bool palette_fit = m_format != PixelFormat::INDEXED ||
+                           (entry.palette_offset >= table_end && entry.palette_offset <= m_file.GetSize() &&
+                            PALETTE_BYTES <= m_file.GetSize() - entry.palette_offset);
+        if (!pixels_fit || !palette_fit)
+        {
+            Close();
+            return false;
+        }
+    }
+    return true;
+}
+
+void AnimCache::Close()
+{
+    m_file.Close();
+    m_width = 0;
+    m_height = 0;
+    m_frameCount = 0;
+    m_frameBytes = 0;
+}
+
+void AnimCache::GetFrame(size_t index, Frame &frame) const
+{
+    CacheFrameEntry entry;
+    memcpy(&entry, m_file.GetData() + sizeof(CacheHeader) + index * sizeof(CacheFrameEntry), sizeof(entry));
+    frame.left = 0;
+    frame.top = 0;
+    frame.width = m_width;
+    frame.height = m_height;
+    frame.delay_ms = entry.delay_ms;
+    frame.dirty = Rect{entry.dirty_x, entry.dirty_y, entry.dirty_width, entry.dirty_height};
+    frame.mapped_data = m_file.GetData() + entry.pixels_offset;
+    frame.color_table.clear();
+    if (m_format == PixelFormat::INDEXED)
+    {
+        const uint8_t *palette = m_file.GetData() + entry.palette_offset;
+        frame.color_table.reserve(256);
+        for (size_t i = 0; i < 256; ++i)
+        {
+            frame.color_table.push_back(Color(palette[i * 3], palette[i * 3 + 1], palette[i * 3 + 2]));
+        }
+    }
+}
+
+bool AnimCache::Write(const std::string &path, const AnimCacheKey &key, int width, int height,
+                      const std::vector<Frame> &frames)
+{
+    size_t frame_bytes = static_cast<size_t>(width) * height * (key.format == PixelFormat::INDEXED ? 1 : 3);
+    CacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.byte_order = ENDIAN_MARK;
+    header.source_hash = key.source_hash;
+    header.source_size = key.source_size;
+    header.width = width;
+    header.height = height;
+    header.format = static_cast<uint32_t>(key.format);
+    header.flip = key.flip;
+    header.frame_count = static_cast<uint32_t>(frames.size());
+
+    // lay out the frame data after the table
+    std::vector<CacheFrameEntry> entries(frames.size());
+    size_t offset = alignUp(sizeof(CacheHeader) + frames.size() * sizeof(CacheFrameEntry));
+    for (size_t i = 0; i < frames.size(); ++i)
+    {
+        const Frame &frame = frames[i];
+        CacheFrameEntry &entry = entries[i];
+        memset(&entry, 0, sizeof(entry));
+        entry.delay_ms = frame.delay_ms;
+        entry.dirty_x = frame.dirty.x;
+        entry.dirty_y = frame.dirty.y;
+        entry.dirty_width = frame.dirty.width;
+        entry.dirty_height = frame.dirty.height;
+        if (frame.same_as >= 0 && static_cast<size_t>(frame.same_as) < i)
+        {
+            // shared frames are stored once
+            entry.pixels_offset = entries[frame.same_as].pixels_offset;
+            entry.palette_offset = entries[frame.same_as].palette_offset;
+            continue;
+        }
+        if (frame.data.size() != frame_bytes)
+        {
+            return false;
+        }
+        entry.pixels_offset = offset;
+        offset = alignUp(offset + frame_bytes);
+        if (key.format == PixelFormat::INDEXED)
+        {
+            entry.palette_offset = offset;
+            offset = alignUp(offset + PALETTE_BYTES);
+        }
+    }
+
+    std::string temp_path = path + ".tmp";
+    std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        return false;
+    }
+    static const char padding[ALIGNMENT] = {};
+    auto pad_to = [&](uint64_t target)
+    {
+        size_t position = static_cast<size_t>(file.tellp());
+        file.write(padding, static_cast<std::streamsize>(target - position));
+    };
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(entries.data()), entries.size() * sizeof(CacheFrameEntry));
+    for (size_t i = 0; i < frames.size(); ++i)
+    {
+        if (frames[i].same_as >= 0)
+        {
+            continue;
+        }
+        pad_to(entries[i].pixels_offset);
+        file.write(reinterpret_cast<const char *>(frames[i].data.data()), frame_bytes);
+        if (key.format == PixelFormat::INDEXED)
+        {
+            uint8_t palette[PALETTE_BYTES] = {};
+            size_t colors = frames[i].color_table.size() < 256 ? frames[i].color_table.size() : 256;
+            memcpy(palette, frames[i].color_table.data(), colors * 3);
+            pad_to(entries[i].palette_offset);
+            file.write(reinterpret_cast<const char *>(palette), PALETTE_BYTES);
+        }
+    }
+    file.close();
+    if (!file)
+    {
+        std::remove(temp_path.c_str());
+        return false;
+    }
+    // Windows will not rename over an existing (stale) cache
+    std::remove(path.c_str());
+    return std::rename(temp_path.c_str(), path.c_str()) == 0;
+}
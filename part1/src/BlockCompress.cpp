@@ -0,0 +1,318 @@
+#include "BlockCompress.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+size_t CompressedSize(TextureCompression compression, int width, int height)
+{
+    size_t blocks = static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4);
+    switch (compression)
+    {
+    case TextureCompression::BC1:
+        return blocks * 8;
+    case TextureCompression::RGTC2:
+        return blocks * 16;
+    default:
+        return 0;
+    }
+}
+
+// Copies the 4x4 block at (block_x, block_y) out of the image, repeating
+// the last row and column where it reaches past the edge
+static void loadBlock(const uint8_t *rgba, int width, int height, int block_x, int block_y, uint8_t block[64])
+{
+    for (int y = 0; y < 4; ++y)
+    {
+        int source_y = std::min(block_y * 4 + y, height - 1);
+        for (int x = 0; x < 4; ++x)
+        {
+            int source_x = std::min(block_x * 4 + x, width - 1);
+            const uint8_t *pixel = rgba + (static_cast<size_t>(source_y) * width + source_x) * 4;
+            std::copy(pixel, pixel + 4, block + (y * 4 + x) * 4);
+        }
+    }
+}
+
+static inline void storeLE16(uint8_t *dest, uint32_t value)
+{
+    dest[0] = static_cast<uint8_t>(value);
+    dest[1] = static_cast<uint8_t>(value >> 8);
+}
+
+static inline uint16_t to565(float r, float g, float b)
+{
+    int r5 = std::clamp(static_cast<int>(r * 31.0f / 255.0f + 0.5f), 0, 31);
+    int g6 = std::clamp(static_cast<int>(g * 63.0f / 255.0f + 0.5f), 0, 63);
+    int b5 = std::clamp(static_cast<int>(b * 31.0f / 255.0f + 0.5f), 0, 31);
+    return static_cast<uint16_t>((r5 << 11) | (g6 << 5) | b5);
+}
+
+// the 8-bit color the GPU decodes a 565 color to
+static inline void from565(uint16_t color, int rgb[3])
+{
+    int r5 = color >> 11;
+    int g6 = (color >> 5) & 63;
+    int b5 = color & 31;
+    rgb[0] = (r5 << 3) | (r5 >> 2);
+    rgb[1] = (g6 << 2) | (g6 >> 4);
+    rgb[2] = (b5 << 3) | (b5 >> 2);
+}
+
+// Picks the nearest of the four colors between color0 and color1 (which
+// must be the larger) for every pixel, returns the squared error
+static int fitBC1Indices(const uint8_t block[64], uint16_t color0, uint16_t color1, uint32_t &indices)
+{
+    int palette[4][3];
+    from565(color0, palette[0]);
+    from565(color1, palette[1]);
+    for (int c = 0; c < 3; ++c)
+    {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+    int error = 0;
+    indices = 0;
+    for (int i = 0; i < 16; ++i)
+    {
+        const uint8_t *pixel = block + i * 4;
+        int best = 0;
+        int best_distance = 1 << 30;
+        for (int p = 0; p < 4; ++p)
+        {
+            int dr = pixel[0] - palette[p][0];
+            int dg = pixel[1] - palette[p][1];
+            int db = pixel[2] - palette[p][2];
+            int distance = dr * dr + dg * dg + db * db;
+            if (distance < best_distance)
+            {
+                best_distance = distance;
+                best = p;
+            }
+        }
+        error += best_distance;
+        indices |= static_cast<uint32_t>(best) << (i * 2);
+    }
+    return error;
+}
+
+// Orders the endpoints for four color mode and fits the indices. Equal
+// endpoints leave no choice, every pixel takes color0.
+static int encodeBC1Endpoints(const uint8_t block[64], uint16_t a, uint16_t b, uint16_t &color0, uint16_t &color1,
+                              uint32_t &indices)
+{
+    color0 = std::max(a, b);
+    color1 = std::min(a, b);
+    if (color0 == color1)
+    {
+        indices = 0;
+        int rgb[3];
+        from565(color0, rgb);
+        int error = 0;
+        for (int i = 0; i < 16; ++i)
+        {
+            for (int c = 0; c < 3; ++c)
+            {
+                int d = block[i * 4 + c] - rgb[c];
+                error += d * d;
+            }
+        }
+        return error;
+    }
+    return fitBC1Indices(block, color0, color1, indices);
+}
+
+static void encodeBC1Block(const uint8_t block[64], uint8_t *dest)
+{
+    // The endpoints start as the pixels furthest apart along the block's
+    // principal axis, found by a few rounds of power iteration
+    float mean[3] = {0.0f, 0.0f, 0.0f};
+    for (int i = 0; i < 16; ++i)
+    {
+        for (int c = 0; c < 3; ++c)
+        {
+            mean[c] += block[i * 4 + c];
+        }
+    }
+    for (float &m : mean)
+    {
+        m /= 16.0f;
+    }
+    float cov[6] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+    for (int i = 0; i < 16; ++i)
+    {
+        float r = block[i * 4] - mean[0];
+        float g = block[i * 4 + 1] - mean[1];
+        float b = block[i * 4 + 2] - mean[2];
+        cov[0] += r * r;
+        cov[1] += r * g;
+        cov[2] += r * b;
+        cov[3] += g * g;
+        cov[4] += g * b;
+        cov[5] += b * b;
+    }
+    float axis[3] = {1.0f, 1.0f, 1.0f};
+    for (int round = 0; round < 4; ++round)
+    {
+        float r = axis[0] * cov[0] + axis[1] * cov[1] + axis[2] * cov[2];
+        float g = axis[0] * cov[1] + axis[1] * cov[3] + axis[2] * cov[4];
+        float b = axis[0] * cov[2] + axis[1] * cov[4] + axis[2] * cov[5];
+        float length = std::max(std::max(std::fabs(r), std::fabs(g)), std::fabs(b));
+        if (length < 1e-6f)
+        {
+            // a flat block, any axis does
+            break;
+        }
+        axis[0] = r / length;
+        axis[1] = g / length;
+        axis[2] = b / length;
+    }
+    int low = 0;
+    int high = 0;
+    float low_projection = 1e30f;
+    float high_projection = -1e30f;
+    for (int i = 0; i < 16; ++i)
+    {
+        float projection = block[i * 4] * axis[0] + block[i * 4 + 1] * axis[1] + block[i * 4 + 2] * axis[2];
+        if (projection < low_projection)
+        {
+            low_projection = projection;
+            low = i;
+        }
+        if (projection > high_projection)
+        {
+            high_projection = projection;
+            high = i;
+        }
+    }
+    const uint8_t *lo = block + low * 4;
+    const uint8_t *hi = block + high * 4;
+    uint16_t color0;
+    uint16_t color1;
+    uint32_t indices;
+    int error = encodeBC1Endpoints(block, to565(hi[0], hi[1], hi[2]), to565(lo[0], lo[1], lo[2]), color0, color1,
+                                   indices);
+
+    // One least squares refit of the endpoints to the chosen blend
+    // weights, kept only if it lowers the error
+    if (error > 0 && color0 != color1)
+    {
+        static const float weights[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+        float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+        float ax[3] = {0.0f, 0.0f, 0.0f};
+        float bx[3] = {0.0f, 0.0f, 0.0f};
+        for (int i = 0; i < 16; ++i)
+        {
+            float a = weights[(indices >> (i * 2)) & 3];
+            float b = 1.0f - a;
+            aa += a * a;
+            ab += a * b;
+            bb += b * b;
+            for (int c = 0; c < 3; ++c)
+            {
+                ax[c] += a * block[i * 4 + c];
+                bx[c] += b * block[i * 4 + c];
+            }
+        }
+        float determinant = aa * bb - ab * ab;
+        if (std::fabs(determinant) > 1e-6f)
+        {
+            float end0[3];
+            float end1[3];
+            for (int c = 0; c < 3; ++c)
+            {
+                end0[c] = (ax[c] * bb - bx[c] * ab) / determinant;
+                end1[c] = (bx[c] * aa - ax[c] * ab) / determinant;
+            }
+            uint16_t refit0;
+            uint16_t refit1;
+            uint32_t refit_indices;
+            int refit_error = encodeBC1Endpoints(block, to565(end0[0], end0[1], end0[2]),
+                                                 to565(end1[0], end1[1], end1[2]), refit0, refit1, refit_indices);
+            if (refit_error < error)
+            {
+                color0 = refit0;
+                color1 = refit1;
+                indices = refit_indices;
+            }
+        }
+    }
+
+    storeLE16(dest, color0);
+    storeLE16(dest + 2, color1);
+    storeLE16(dest + 4, indices);
+    storeLE16(dest + 6, indices >> 16);
+}
+
+// One channel as an RGTC block: the channel's largest and smallest value
+// and 3 bits per pixel choosing one of the eight steps between them
+static void encodeRGTCChannel(const uint8_t block[64], int channel, uint8_t *dest)
+{
+    int low = 255;
+    int high = 0;
+    for (int i = 0; i < 16; ++i)
+    {
+        low = std::min(low, static_cast<int>(block[i * 4 + channel]));
+        high = std::max(high, static_cast<int>(block[i * 4 + channel]));
+    }
+    // With the first value larger the GPU interpolates six values in
+    // between, index 0 is the high end, 1 the low end and index i of the
+    // rest is (8 - i) sevenths of the way up
+    dest[0] = static_cast<uint8_t>(high);
+    dest[1] = static_cast<uint8_t>(low);
+    uint64_t indices = 0;
+    if (high > low)
+    {
+        int range = high - low;
+        for (int i = 0; i < 16; ++i)
+        {
+            int step = ((block[i * 4 + channel] - low) * 14 + range) / (2 * range);
+            uint64_t index = step == 7 ? 0 : (step == 0 ? 1 : 8 - step);
+            indices |= index << (i * 3);
+        }
+    }
+    for (int b = 0; b < 6; ++b)
+    {
+        dest[2 + b] = static_cast<uint8_t>(indices >> (b * 8));
+    }
+}
+
+void CompressBC1(const uint8_t *rgba, int width, int height, uint8_t *dest)
+{
+    uint8_t block[64];
+    for (int block_y = 0; block_y < (height + 3) / 4; ++block_y)
+    {
+        for (int block_x = 0; block_x < (width + 3) / 4; ++block_x)
+        {
+            loadBlock(rgba, width, height, block_x, block_y, block);
+            encodeBC1Block(block, dest);
+            dest += 8;
+        }
+    }
+}
+
+void CompressRGTC2(const uint8_t *rgba, int width, int height, uint8_t *dest)
+{
+    uint8_t block[64];
+    for (int block_y = 0; block_y < (height + 3) / 4; ++block_y)
+    {
+        for (int block_x = 0; block_x < (width + 3) / 4; ++block_x)
+        {
+            loadBlock(rgba, width, height, block_x, block_y, block);
+            encodeRGTCChannel(block, 0, dest);
+            encodeRGTCChannel(block, 1, dest + 8);
+            dest += 16;
+        }
+    }
+}
+
+void CompressImage(TextureCompression compression, const uint8_t *rgba, int width, int height, uint8_t *dest)
+{
+    if (compression == TextureCompression::BC1)
+    {
+        CompressBC1(rgba, width, height, dest);
+    }
+    else if (compression == TextureCompression::RGTC2)
+    {
+        CompressRGTC2(rgba, width, height, dest);
+    }
+}
@@ -0,0 +1,114 @@
+#include "FrameBuilder.hpp"
+
+void PrepareFrame(const uint8_t *rgba, int width, int height, const FrameFormat &format, PreparedFrame &frame)
+{
+    if (format.mipmaps)
+    {
+        BuildMipChain(rgba, width, height, format.gamma_correct, frame.mips);
+    }
+    else
+    {
+        frame.mips.levels.clear();
+    }
+    frame.compressed_offsets.clear();
+    frame.compressed.clear();
+    if (format.compression == TextureCompression::NONE)
+    {
+        return;
+    }
+    size_t bytes = CompressedSize(format.compression, width, height);
+    frame.compressed_offsets.push_back(0);
+    for (const MipLevel &level : frame.mips.levels)
+    {
+        frame.compressed_offsets.push_back(bytes);
+        bytes += CompressedSize(format.compression, level.width, level.height);
+    }
+    frame.compressed.resize(bytes);
+    CompressImage(format.compression, rgba, width, height, frame.compressed.data());
+    for (size_t i = 0; i < frame.mips.levels.size(); ++i)
+    {
+        const MipLevel &level = frame.mips.levels[i];
+        CompressImage(format.compression, frame.mips.pixels.data() + level.offset, level.width, level.height,
+                      frame.compressed.data() + frame.compressed_offsets[i + 1]);
+    }
+}
+
+FrameBuilder::~FrameBuilder()
+{
+    Stop();
+}
+
+void FrameBuilder::Start(int width, int height, const FrameFormat &format)
+{
+    Stop();
+    m_width = width;
+    m_height = height;
+    m_format = format;
+    m_input.resize(static_cast<size_t>(width) * height * 4);
+    m_pending = false;
+    m_stop = false;
+    m_builtId = -1;
+    m_submittedId = -1;
+    m_worker = std::thread(&FrameBuilder::run, this);
+}
+
+void FrameBuilder::Stop()
+{
+    if (!m_worker.joinable())
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_one();
+    m_worker.join();
+}
+
+uint8_t *FrameBuilder::Input()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pending ? nullptr : m_input.data();
+}
+
+void FrameBuilder::Submit(int id)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_pending)
+        {
+            return;
+        }
+        m_pending = true;
+        m_submittedId = id;
+        m_builtId = -1;
+    }
+    m_wake.notify_one();
+}
+
+const PreparedFrame *FrameBuilder::Take(int id)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return !m_pending && m_builtId == id ? &m_frame : nullptr;
+}
+
+void FrameBuilder::run()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        m_wake.wait(lock, [this]() { return m_stop || m_pending; });
+        if (m_stop)
+        {
+            return;
+        }
+        // The render thread keeps its hands off the buffers while a build
+        // is pending, so the lock is not needed for the build itself
+        lock.unlock();
+        PrepareFrame(m_input.data(), m_width, m_height, m_format, m_frame);
+        lock.lock();
+        m_builtId = m_submittedId;
+        m_pending = false;
+    }
+}
@@ -0,0 +1,72 @@
+#include "FrameCache.hpp"
+
+#include <cstring>
+#include <utility>
+
+void FrameCache::SetBudget(size_t budget_bytes)
+{
+    m_budget = budget_bytes;
+    while (m_bytes > m_budget && m_entries.size() > 1)
+    {
+        evictOldest();
+    }
+}
+
+uint8_t *FrameCache::Find(int index)
+{
+    auto found = m_lookup.find(index);
+    if (found == m_lookup.end())
+    {
+        m_misses++;
+        return nullptr;
+    }
+    m_hits++;
+    m_entries.splice(m_entries.begin(), m_entries, found->second);
+    return found->second->pixels.data();
+}
+
+uint8_t *FrameCache::Insert(int index, const uint8_t *pixels, size_t size)
+{
+    auto found = m_lookup.find(index);
+    if (found != m_lookup.end())
+    {
+        // replace the old copy rather than keeping two
+        m_bytes -= found->second->pixels.size();
+        m_spare = std::move(found->second->pixels);
+        m_entries.erase(found->second);
+        m_lookup.erase(found);
+    }
+    while (!m_entries.empty() && m_bytes + size > m_budget)
+    {
+        evictOldest();
+    }
+
+    Entry entry;
+    entry.index = index;
+    entry.pixels = std::move(m_spare);
+    m_spare.clear();
+    entry.pixels.resize(size);
+    memcpy(entry.pixels.data(), pixels, size);
+    m_entries.push_front(std::move(entry));
+    m_lookup[index] = m_entries.begin();
+    m_bytes += size;
+    return m_entries.front().pixels.data();
+}
+
+void FrameCache::Clear()
+{
+    m_entries.clear();
+    m_lookup.clear();
+    m_spare.clear();
+    m_spare.shrink_to_fit();
+    m_bytes = 0;
+}
+
+void FrameCache::evictOldest()
+{
+    Entry &oldest = m_entries.back();
+    m_bytes -= oldest.pixels.size();
+    m_lookup.erase(oldest.index);
+    m_spare = std::move(oldest.pixels);
+    m_entries.pop_back();
+}
@@ -0,0 +1,101 @@
+#include "FramePrefetcher.hpp"
+
+#include <chrono>
+
+FramePrefetcher::~FramePrefetcher()
+{
+    Stop();
+}
+
+void FramePrefetcher::Start(int frame_count, int first_index, size_t ahead, size_t frame_bytes,
+                            DecodeFunction decode)
+{
+    Stop();
+    m_frameCount = frame_count;
+    m_decode = decode;
+    // one slot for the frame on screen plus the ones decoded ahead of it
+    m_slots.assign(ahead + 1, PrefetchedFrame());
+    for (PrefetchedFrame &slot : m_slots)
+    {
+        slot.pixels.resize(frame_bytes);
+    }
+    m_stalls = 0;
+    m_stop = false;
+
+    m_slots[0].index = first_index;
+    m_slots[0].error.clear();
+    m_decode(first_index, m_slots[0]);
+    m_nextIndex = (first_index + 1) % m_frameCount;
+    m_tail.store(0, std::memory_order_relaxed);
+    m_head.store(1, std::memory_order_release);
+    if (m_frameCount > 1 && m_slots[0].error.empty())
+    {
+        m_worker = std::thread(&FramePrefetcher::run, this);
+    }
+}
+
+void FramePrefetcher::Stop()
+{
+    if (!m_worker.joinable())
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_stop = true;
+    }
+    m_wake.notify_one();
+    m_worker.join();
+}
+
+const PrefetchedFrame *FramePrefetcher::Peek() const
+{
+    size_t tail = m_tail.load(std::memory_order_relaxed);
+    if (m_head.load(std::memory_order_acquire) - tail < 2)
+    {
+        return nullptr;
+    }
+    return &m_slots[(tail + 1) % m_slots.size()];
+}
+
+bool FramePrefetcher::Advance()
+{
+    if (Peek() == nullptr)
+    {
+        m_stalls++;
+        return false;
+    }
+    m_tail.fetch_add(1, std::memory_order_release);
+    // never blocks, at worst the worker notices a little later
+    m_wake.notify_one();
+    return true;
+}
+
+void FramePrefetcher::run()
+{
+    while (!m_stop.load(std::memory_order_relaxed))
+    {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tail.load(std::memory_order_acquire) == m_slots.size())
+        {
+            // Ring is full. Advance may notify between the check and the
+            // wait, so do not sleep for long.
+            std::unique_lock<std::mutex> lock(m_wakeMutex);
+            m_wake.wait_for(lock, std::chrono::milliseconds(5), [this, head]()
+                            { return m_stop.load() || head - m_tail.load() < m_slots.size(); });
+            continue;
+        }
+        PrefetchedFrame &slot = m_slots[head % m_slots.size()];
+        slot.index = m_nextIndex;
+        slot.error.clear();
+        m_decode(m_nextIndex, slot);
+        m_nextIndex = (m_nextIndex + 1) % m_frameCount;
+        m_head.store(head + 1, std::memory_order_release);
+        if (!slot.error.empty())
+        {
+            // the frames after it are drawn on top of it, so none of them
+            // can be decoded either
+            return;
+        }
+    }
+}
@@ -0,0 +1,139 @@
+#include "GifCompositor.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+// Smallest rect covering both a and b, empty rects are ignored
+static Rect unionRect(const Rect &a, const Rect &b)
+{
+    if (a.width <= 0 || a.height <= 0)
+    {
+        return b;
+    }
+    if (b.width <= 0 || b.height <= 0)
+    {
+        return a;
+    }
+    int x0 = std::min(a.x, b.x);
+    int y0 = std::min(a.y, b.y);
+    int x1 = std::max(a.x + a.width, b.x + b.width);
+    int y1 = std::max(a.y + a.height, b.y + b.height);
+    return Rect{x0, y0, x1 - x0, y1 - y0};
+}
+
+void GifCompositor::Reset(int width, int height, PixelFormat format, bool flip, uint8_t background_index,
+                          const std::vector<Color> &global_color_table)
+{
+    m_width = width;
+    m_height = height;
+    m_flip = flip;
+    m_bytesPerPixel = format == PixelFormat::INDEXED ? 1 : 3;
+    if (format == PixelFormat::INDEXED)
+    {
+        m_background[0] = background_index;
+    }
+    else if (background_index < global_color_table.size())
+    {
+        const Color &color = global_color_table[background_index];
+        m_background[0] = color.r;
+        m_background[1] = color.g;
+        m_background[2] = color.b;
+    }
+    m_canvas.assign(static_cast<size_t>(width) * height * m_bytesPerPixel, 0);
+    Restart();
+}
+
+void GifCompositor::Restart()
+{
+    m_saved.clear();
+    fillBackground(Rect{0, 0, m_width, m_height});
+    m_hasPrevious = false;
+    m_previousDisposal = Disposal::NONE;
+}
+
+void GifCompositor::BeginFrame(const Frame &frame)
+{
+    Rect frame_rect = clip(Rect{frame.left, frame.top, frame.width, frame.height});
+    if (!m_hasPrevious)
+    {
+        // the first frame shows the whole canvas, background included
+        m_dirty = Rect{0, 0, m_width, m_height};
+    }
+    else
+    {
+        m_dirty = frame_rect;
+        if (m_previousDisposal == Disposal::BACKGROUND)
+        {
+            fillBackground(m_previousRect);
+            m_dirty = unionRect(m_dirty, m_previousRect);
+        }
+        else if (m_previousDisposal == Disposal::PREVIOUS)
+        {
+            restoreSaved(m_previousRect);
+            m_dirty = unionRect(m_dirty, m_previousRect);
+        }
+    }
+    if (frame.disposal == Disposal::PREVIOUS)
+    {
+        // keep what is under this frame so it can be put back afterwards
+        m_saved = m_canvas;
+    }
+}
+
+void GifCompositor::EndFrame(Frame &frame)
+{
+    frame.dirty = toStorage(m_dirty);
+    m_hasPrevious = true;
+    m_previousRect = clip(Rect{frame.left, frame.top, frame.width, frame.height});
+    m_previousDisposal = frame.disposal;
+}
+
+Rect GifCompositor::clip(const Rect &r) const
+{
+    int x0 = std::max(r.x, 0);
+    int y0 = std::max(r.y, 0);
+    int x1 = std::min(r.x + r.width, m_width);
+    int y1 = std::min(r.y + r.height, m_height);
+    if (x1 <= x0 || y1 <= y0)
+    {
+        return Rect{0, 0, 0, 0};
+    }
+    return Rect{x0, y0, x1 - x0, y1 - y0};
+}
+
+Rect GifCompositor::toStorage(const Rect &r) const
+{
+    if (!m_flip)
+    {
+        return r;
+    }
+    // reversing the pixel order mirrors both axes
+    return Rect{m_width - r.x - r.width, m_height - r.y - r.height, r.width, r.height};
+}
+
+void GifCompositor::fillBackground(const Rect &r)
+{
+    Rect stored = toStorage(r);
+    for (int y = stored.y; y < stored.y + stored.height; ++y)
+    {
+        uint8_t *row = m_canvas.data() + (static_cast<size_t>(y) * m_width + stored.x) * m_bytesPerPixel;
+        for (int x = 0; x < stored.width; ++x)
+        {
+            memcpy(row + x * m_bytesPerPixel, m_background, m_bytesPerPixel);
+        }
+    }
+}
+
+void GifCompositor::restoreSaved(const Rect &r)
+{
+    if (m_saved.size() != m_canvas.size())
+    {
+        return;
+    }
+    Rect stored = toStorage(r);
+    for (int y = stored.y; y < stored.y + stored.height; ++y)
+    {
+        size_t offset = (static_cast<size_t>(y) * m_width + stored.x) * m_bytesPerPixel;
+        memcpy(m_canvas.data() + offset, m_saved.data() + offset, static_cast<size_t>(stored.width) * m_bytesPerPixel);
+    }
+}
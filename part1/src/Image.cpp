@@ -1,11 +1,21 @@
 #include "Image.hpp"
-#include <fstream>
-#include <iostream>
+#include "LZWDecoder.hpp"
+#include "FrameWriter.hpp"
+#include "ParallelFor.hpp"
+#include "ByteCursor.hpp"
+#include "Hash.hpp"
+#include "Log.hpp"
+#include <sstream>
 #include <string.h>
 #include <stdio.h>
 #include <memory>
 #include <vector>
 #include <bitset>
+#include <stdexcept>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
 
 // From Professor Shah's example code
 
@@ -17,6 +27,8 @@ Image::Image(std::string filepath) : m_filepath(filepath)
 // Destructor
 Image::~Image()
 {
+    // the worker decodes into members, stop it before they go away
+    m_prefetcher.Stop();
     // Delete our pixel data.
     // Note: We could actually do this sooner
     // in our rendering process.
@@ -26,6 +38,23 @@ Image::~Image()
     }
 }
 
+// Reads a decimal value the way atoi would, without needing the line to
+// be null terminated
+static uint8_t parseByte(std::string_view text)
+{
+    size_t i = 0;
+    while (i < text.size() && (text[i] == ' ' || text[i] == '\t'))
+    {
+        i++;
+    }
+    unsigned int value = 0;
+    for (; i < text.size() && text[i] >= '0' && text[i] <= '9'; ++i)
+    {
+        value = value * 10 + (text[i] - '0');
+    }
+    return static_cast<uint8_t>(value);
+}
+
 // Little function for loading the pixel data
 // from a PPM image.
 // TODO: Expects a very specific version of PPM!
@@ -35,49 +64,53 @@ Image::~Image()
 void Image::LoadPPM(bool flip)
 {
 
-    // Open an input file stream for reading a file
-    std::ifstream ppmFile(m_filepath.c_str());
+    // Map the file so its lines can be parsed in place
+    MappedFile ppmFile;
     // If our file successfully opens, begin to process it.
-    if (ppmFile.is_open())
+    if (ppmFile.Open(m_filepath))
     {
-        // line will store one line of input
-        std::string line;
+        ByteCursor cursor(ppmFile.GetData(), ppmFile.GetSize());
         // Our loop invariant is to continue reading input until
-        // we reach the end of the file and it reads in a NULL character
-        std::cout << "Reading in ppm file: " << m_filepath << std::endl;
+        // we reach the end of the file
+        LOG_INFO("Reading in ppm file: " << m_filepath);
         unsigned int iteration = 0;
         unsigned int pos = 0;
-        while (getline(ppmFile, line))
+        unsigned int size = 0;
+        while (!cursor.AtEnd())
         {
+            // line points straight into the mapped file
+            std::string_view line = cursor.ReadLine();
             // Ignore comments in the file
-            if (line[0] == '#')
+            if (!line.empty() && line[0] == '#')
             {
                 continue;
             }
-            if (line[0] == 'P')
+            if (!line.empty() && line[0] == 'P')
             {
-                magicNumber = line;
+                magicNumber = std::string(line);
             }
             else if (iteration == 1)
             {
                 // Returns first token
-                char *token = strtok((char *)line.c_str(), " ");
-                m_width = atoi(token);
+                std::string dimensions(line);
+                char *token = strtok((char *)dimensions.c_str(), " ");
+                m_width = token != NULL ? atoi(token) : 0;
                 token = strtok(NULL, " ");
-                m_height = atoi(token);
-                std::cout << "PPM width,height=" << m_width << "," << m_height << "\n";
+                m_height = token != NULL ? atoi(token) : 0;
+                LOG_DEBUG("PPM width,height=" << m_width << "," << m_height);
                 if (m_width > 0 && m_height > 0)
                 {
-                    m_pixelData = new uint8_t[m_width * m_height * 3];
+                    size = m_width * m_height * 3;
+                    m_pixelData = new uint8_t[size];
                     if (m_pixelData == NULL)
                     {
-                        std::cout << "Unable to allocate memory for ppm" << std::endl;
+                        LOG_ERROR("Unable to allocate memory for ppm");
                         exit(1);
                     }
                 }
                 else
                 {
-                    std::cout << "PPM not parsed correctly, width and/or height dimensions are 0" << std::endl;
+                    LOG_ERROR("PPM not parsed correctly, width and/or height dimensions are 0");
                     exit(1);
                 }
             }
@@ -86,18 +119,17 @@ void Image::LoadPPM(bool flip)
                 // max color range is stored here
                 // TODO: Can be stored optionally
             }
-            else
+            else if (pos < size)
             {
-                m_pixelData[pos] = (uint8_t)atoi(line.c_str());
+                m_pixelData[pos] = parseByte(line);
                 ++pos;
             }
             iteration++;
         }
-        ppmFile.close();
     }
     else
     {
-        std::cout << "Unable to open ppm file:" << m_filepath << std::endl;
+        LOG_ERROR("Unable to open ppm file:" << m_filepath);
     }
 
     // Flip all of the pixels
@@ -142,33 +174,220 @@ enum class GifState
     TRAILER
 };
 
-void Image::LoadGIF(bool flip)
+void Image::LoadGIF(bool flip, PixelFormat format)
 {
-    // Open an binary input file stream for reading a file
-    std::ifstream file(m_filepath.c_str(), std::ios::binary);
-    if (!file)
+    // Frames are written flipped as they are decoded
+    m_flip = flip;
+    m_format = format;
+
+    AnimCacheKey cache_key;
+    if (!m_cache_path.empty())
     {
-        std::cerr << "Failed to open GIF.\n";
-        return;
+        // the cache is only valid for exactly this file's bytes
+        if (!m_file.Open(m_filepath))
+        {
+            LOG_ERROR("Failed to open GIF.");
+            return;
+        }
+        cache_key.source_hash = HashBytes(m_file.GetData(), m_file.GetSize());
+        cache_key.source_size = m_file.GetSize();
+        cache_key.format = m_format;
+        cache_key.flip = m_flip;
+        bool loaded = loadCache(cache_key);
+        if (!loaded && m_format == PixelFormat::INDEXED)
+        {
+            // a GIF with local color tables is cached as RGB, and an RGB
+            // cache of the same file shows the same pixels either way
+            AnimCacheKey rgb_key = cache_key;
+            rgb_key.format = PixelFormat::RGB;
+            loaded = loadCache(rgb_key);
+        }
+        if (loaded)
+        {
+            LOG_INFO("Loaded " << m_frames.size() << " frames (" << GetUniqueFrameCount() << " unique) from cache "
+                               << m_cache_path);
+            return;
+        }
+        LOG_INFO("Cache " << m_cache_path << " is missing or stale, rebuilding it");
+    }
+
+    try
+    {
+        if (!parseGIF())
+        {
+            return;
+        }
+    }
+    catch (const std::runtime_error &e)
+    {
+        LOG_ERROR("Failed to parse GIF: " << e.what());
+        exit(1);
+    }
+    // parsing may have fallen back to RGB
+    cache_key.format = m_format;
+    // the global color table is known by now, so the canvas can be set up
+    m_compositor.Reset(m_width, m_height, m_format, m_flip, m_background_index, m_global_color_table);
+
+    // Image data is only checked as it is decoded, a corrupt frame is
+    // malformed input like any other
+    try
+    {
+        if (!m_cache_path.empty())
+        {
+            // the cache needs every frame decoded in full, after that the
+            // frames are used from the cache file rather than kept in memory
+            m_keyframe_interval = 0;
+            decodeFrames();
+            if (AnimCache::Write(m_cache_path, cache_key, m_width, m_height, m_frames) && loadCache(cache_key))
+            {
+                return;
+            }
+            LOG_ERROR("Failed to write cache " << m_cache_path);
+            // every frame is decoded in memory now, like without a cache,
+            // and there is no file left to decode frames from
+            m_lazy = false;
+            m_decode_ahead = 0;
+            m_file.Close();
+        }
+        else if (!m_lazy)
+        {
+            decodeFrames();
+            // nothing points into the file any more
+            m_file.Close();
+        }
+        else if (m_decode_ahead > 0 && !m_frames.empty())
+        {
+            // The worker cannot exit the program, it hands the error of a
+            // frame that fails to the render thread with the frame
+            m_prefetcher.Start(static_cast<int>(m_frames.size()), 0, m_decode_ahead, m_compositor.GetCanvasSize(),
+                               [this](int index, PrefetchedFrame &out)
+                               {
+                                   try
+                                   {
+                                       memcpy(out.pixels.data(), decodeFrame(index), out.pixels.size());
+                                       out.dirty = m_frames[index].dirty;
+                                   }
+                                   catch (const std::runtime_error &e)
+                                   {
+                                       out.error = e.what();
+                                   }
+                               });
+            checkPrefetched(m_prefetcher.Current());
+        }
+    }
+    catch (const std::runtime_error &e)
+    {
+        LOG_ERROR("Failed to decode GIF: " << e.what());
+        exit(1);
+    }
+
+    return;
+}
+
+void Image::checkPrefetched(const PrefetchedFrame &frame)
+{
+    if (!frame.error.empty())
+    {
+        LOG_ERROR("Failed to decode GIF frame " << frame.index << ": " << frame.error);
+        exit(1);
+    }
+}
+
+bool Image::Probe(const std::string &filepath, GifIndex &index)
+{
+    Image image(filepath);
+    try
+    {
+        if (!image.parseGIF())
+        {
+            return false;
+        }
+    }
+    catch (const std::runtime_error &e)
+    {
+        LOG_ERROR("Failed to parse GIF: " << e.what());
+        return false;
+    }
+
+    index = GifIndex();
+    index.width = image.m_width;
+    index.height = image.m_height;
+    index.has_global_color_table = image.m_has_global_color_table;
+    index.background_index = image.m_background_index;
+    index.file_size = image.m_file.GetSize();
+    index.frames.reserve(image.m_frames.size());
+    for (const Frame &frame : image.m_frames)
+    {
+        GifFrameInfo info;
+        info.rect = Rect{frame.left, frame.top, frame.width, frame.height};
+        info.delay_ms = ShownDelayMs(frame.delay_ms);
+        info.disposal = frame.disposal;
+        info.transparent_index = frame.transparent_index;
+        info.interlaced = frame.interlaced;
+        info.data_offset = static_cast<size_t>(frame.lzw_blocks - image.m_file.GetData());
+        info.data_size = frame.lzw_blocks_size;
+        index.frames.push_back(info);
+        index.total_duration_ms += info.delay_ms;
+    }
+    return true;
+}
+
+bool Image::loadCache(const AnimCacheKey &key)
+{
+    if (!m_anim_cache.Open(m_cache_path, key))
+    {
+        return false;
+    }
+    m_format = key.format;
+    m_width = m_anim_cache.GetWidth();
+    m_height = m_anim_cache.GetHeight();
+    m_frames.assign(m_anim_cache.GetFrameCount(), Frame());
+    // frames that were shared when the cache was written point at the
+    // same pixels in it
+    std::unordered_map<const uint8_t *, int> first_use;
+    for (size_t i = 0; i < m_frames.size(); ++i)
+    {
+        m_anim_cache.GetFrame(i, m_frames[i]);
+        auto inserted = first_use.emplace(m_frames[i].mapped_data, static_cast<int>(i));
+        m_frames[i].same_as = inserted.second ? -1 : inserted.first->second;
+    }
+    // frames are already composited, nothing is left to decode
+    m_lazy = false;
+    m_decode_ahead = 0;
+    m_file.Close();
+    return true;
+}
+
+bool Image::parseGIF()
+{
+    // Map the file, frames keep pointing at their image data inside it
+    // until they are decoded
+    if (!m_file.Open(m_filepath))
+    {
+        LOG_ERROR("Failed to open GIF.");
+        return false;
     }
+    ByteCursor file(m_file.GetData(), m_file.GetSize());
 
     GifState state = GifState::HEADER;
+    bool done = false;
 
     // state machine based off diagram at https://giflib.sourceforge.net/whatsinagif/gif_file_stream.gif
-    while (!file.eof())
+    // image data is only skipped over here, it is decoded afterwards
+    while (!done && !file.AtEnd())
     {
         switch (state)
         {
         case GifState::HEADER:
-            std::cout << "Attempting to read GIF header.\n";
+            LOG_TRACE("Attempting to read GIF header.");
             parseHeader(file);
-            std::cout << "Successfully read GIF header.\n";
+            LOG_TRACE("Successfully read GIF header.");
             state = GifState::LOGICAL_SCREEN_DESCRIPTOR;
             break;
         case GifState::LOGICAL_SCREEN_DESCRIPTOR:
-            std::cout << "Attempting to read logical screen descriptor.\n";
+            LOG_TRACE("Attempting to read logical screen descriptor.");
             parseLogicalScreenDescriptor(file);
-            std::cout << "Successfully read logical screen descriptor.\n";
+            LOG_TRACE("Successfully read logical screen descriptor.");
             if (m_has_global_color_table)
             {
                 state = GifState::GLOBAL_COLOR_TABLE;
@@ -179,35 +398,35 @@ void Image::LoadGIF(bool flip)
             }
             break;
         case GifState::GLOBAL_COLOR_TABLE:
-            std::cout << "Attempting to read global color table.\n";
+            LOG_TRACE("Attempting to read global color table.");
             parseGlobalColorTable(file);
-            std::cout << "Successfully read global color table.\n";
+            LOG_TRACE("Successfully read global color table.");
             state = GifState::CONTENT_BLOCK;
         case GifState::CONTENT_BLOCK:
-            std::cout << "Attempting to read content block.\n";
-            if (file.peek() == 0x21)
+            LOG_TRACE("Attempting to read content block.");
+            if (file.Peek() == 0x21)
             {
                 state = GifState::EXTENSION_BLOCK;
             }
-            else if (file.peek() == 0x2C)
+            else if (file.Peek() == 0x2C)
             {
                 state = GifState::IMAGE_DESCRIPTOR;
             }
-            else if (file.peek() == 0x3B)
+            else if (file.Peek() == 0x3B)
             {
                 state = GifState::TRAILER;
             }
             else
             {
-                std::cerr << "Encountered unexpected byte in content block start " << file.peek() << "\n";
-                exit(1);
+                throw std::runtime_error("Encountered unexpected byte in content block start " +
+                                         std::to_string(file.Peek()));
             }
-            std::cout << "Successfully read content block.\n";
+            LOG_TRACE("Successfully read content block.");
             break;
         case GifState::IMAGE_DESCRIPTOR:
-            std::cout << "Attempting to read image descriptor.\n";
+            LOG_TRACE("Attempting to read image descriptor.");
             parseImageDescriptor(file);
-            std::cout << "Successfully read image descriptor.\n";
+            LOG_TRACE("Successfully read image descriptor.");
             if (m_next_has_local_color_table)
             {
                 state = GifState::LOCAL_COLOR_TABLE;
@@ -218,26 +437,28 @@ void Image::LoadGIF(bool flip)
             }
             break;
         case GifState::LOCAL_COLOR_TABLE:
-            std::cout << "Attempting to read local color table.\n";
+            LOG_TRACE("Attempting to read local color table.");
             parseLocalColorTable(file);
-            std::cout << "Successfully read local color table.\n";
+            LOG_TRACE("Successfully read local color table.");
             state = GifState::IMAGE_DATA;
             break;
         case GifState::IMAGE_DATA:
-            std::cout << "Attempting to read image data.\n";
+            LOG_TRACE("Attempting to read image data.");
             parseImageData(file);
-            std::cout << "Successfully read image data.\n";
+            LOG_TRACE("Successfully read image data.");
             state = GifState::CONTENT_BLOCK;
             break;
         case GifState::EXTENSION_BLOCK:
-            std::cout << "Attempting to read extension block.\n";
-            char extension_type[2];
-            file.read(extension_type, 1);
-            if (extension_type[1] == 0xF9)
+            LOG_TRACE("Attempting to read extension block.");
+            // extension introducer (0x21) followed by the extension label
+            file.Skip(1);
+            uint8_t extension_label;
+            extension_label = file.ReadU8();
+            if (extension_label == 0xF9)
             {
                 state = GifState::GRAPHIC_CONTROL_EXTENSION;
             }
-            else if (extension_type[1] == 0x01 || extension_type[1] == 0xFF)
+            else if (extension_label == 0x01 || extension_label == 0xFF)
             {
                 state = GifState::PLAIN_TEXT_OR_APPLICATION_EXTENSION;
             }
@@ -245,67 +466,57 @@ void Image::LoadGIF(bool flip)
             {
                 state = GifState::COMMENT_EXTENSION;
             }
-            std::cout << "Successfully read extension block.\n";
+            LOG_TRACE("Successfully read extension block.");
             break;
         case GifState::GRAPHIC_CONTROL_EXTENSION:
-            std::cout << "Attempting to read graphic control extension.\n";
+            LOG_TRACE("Attempting to read graphic control extension.");
             parseGraphicControlExtension(file);
-            std::cout << "Successfully read graphic control extension.\n";
+            LOG_TRACE("Successfully read graphic control extension.");
             state = GifState::CONTENT_BLOCK;
             break;
         case GifState::PLAIN_TEXT_OR_APPLICATION_EXTENSION:
-            std::cout << "Attempting to read plain text or application extension.\n";
-            // no useful information in these blocks
-            char block_size;
-            file.read(&block_size, 1);
-            file.ignore(block_size);
-            state = GifState::CONTENT_BLOCK;
-            std::cout << "Successfully read plain text or application extension.\n";
+            LOG_TRACE("Attempting to read plain text or application extension.");
+            // no useful information in these blocks, skip the fixed size
+            // block and then the sub-blocks that follow it like a comment
+            file.Skip(file.ReadU8());
+            state = GifState::COMMENT_EXTENSION;
+            LOG_TRACE("Successfully read plain text or application extension.");
             break;
         case GifState::COMMENT_EXTENSION:
-            std::cout << "Attempting to read comment extension.\n";
+            LOG_TRACE("Attempting to read comment extension.");
             // no useful information in this block but does not have an explicit
             // block size so we need to skip subblocks until we reach a subblock
             // of size (see https://giflib.sourceforge.net/whatsinagif/comment_ext.gif)
-            char sub_block_size;
-            file.read(&sub_block_size, 1);
+            uint8_t sub_block_size;
+            sub_block_size = file.ReadU8();
             while (sub_block_size != 0x00)
             {
-                file.ignore(sub_block_size);
-                file.read(&sub_block_size, 1);
+                file.Skip(sub_block_size);
+                sub_block_size = file.ReadU8();
             }
             state = GifState::CONTENT_BLOCK;
-            std::cout << "Successfully read comment extension.\n";
+            LOG_TRACE("Successfully read comment extension.");
             break;
         case GifState::TRAILER:
-            std::cout << "Attempting to read GIF trailer.\n";
-            char marker;
-            file.read(&marker, 1);
-            if (marker != 0x3B)
+            LOG_TRACE("Attempting to read GIF trailer.");
+            if (file.ReadU8() != 0x3B)
             {
-                std::cerr << "Invalid GIF trailer.\n";
+                LOG_ERROR("Invalid GIF trailer.");
             }
-            if (file.peek() != EOF)
+            if (!file.AtEnd())
             {
-                std::cerr << "Trailer not at end of file.\n";
+                LOG_ERROR("Trailer not at end of file.");
             }
-            std::cout << "Successfully read GIF trailer.\n";
+            LOG_TRACE("Successfully read GIF trailer.");
+            done = true;
             break;
         }
     }
-
-    file.close();
-
-    // Flip all of the pixels
-    if (flip)
+    if (!done)
     {
-        for (Frame &frame : m_frames)
-        {
-            flipData(frame.data.data());
-        }
+        LOG_ERROR("GIF has no trailer.");
     }
-
-    return;
+    return true;
 }
 
 uint16_t littleEndianToBigEndian(uint8_t value1, uint8_t value2)
@@ -313,69 +524,74 @@ uint16_t littleEndianToBigEndian(uint8_t value1, uint8_t value2)
     return (value2 << 8) | value1;
 }
 
-void Image::parseHeader(std::ifstream &stream)
+void Image::parseHeader(ByteCursor &stream)
 {
-    char header[6];
-    stream.read(header, 6);
+    const char *header = reinterpret_cast<const char *>(stream.ReadBytes(6));
     if (strncmp(header, "GIF87a", 6) != 0 && strncmp(header, "GIF89a", 6) != 0)
     {
-        std::cerr << "Invalid GIF header.\n";
-        return;
+        throw std::runtime_error("Invalid GIF header");
     }
 }
 
-void Image::parseLogicalScreenDescriptor(std::ifstream &stream)
+void Image::parseLogicalScreenDescriptor(ByteCursor &stream)
 {
-    char descriptor[7];
-    stream.read(descriptor, 7);
+    const uint8_t *descriptor = stream.ReadBytes(7);
     m_width = littleEndianToBigEndian(descriptor[0], descriptor[1]);
     m_height = littleEndianToBigEndian(descriptor[2], descriptor[3]);
-    std::cout << "GIF width,height=" << m_width << "," << m_height << "\n";
+    LOG_DEBUG("GIF width,height=" << m_width << "," << m_height);
     uint8_t packed_field = descriptor[4];
     m_has_global_color_table = packed_field & 0b10000000;
     m_global_color_resolution = (packed_field & 0b00000111);
-    std::cout << "Global color resolution " << m_global_color_resolution << "\n";
+    m_background_index = descriptor[5];
+    LOG_DEBUG("Global color resolution " << m_global_color_resolution);
 }
 
 // https://giflib.sourceforge.net/whatsinagif/global_color_table.gif
-void Image::parseGlobalColorTable(std::ifstream &stream)
+void Image::parseGlobalColorTable(ByteCursor &stream)
 {
     parseColorTable(stream, m_global_color_table, m_global_color_resolution);
 }
 
-void Image::parseLocalColorTable(std::ifstream &stream)
+void Image::parseLocalColorTable(ByteCursor &stream)
 {
-    Frame last_frame = m_frames.back();
+    Frame &last_frame = m_frames.back();
     parseColorTable(stream, last_frame.color_table, last_frame.color_resolution);
 }
 
-void Image::parseColorTable(std::ifstream &stream, std::vector<Color> &table, int color_resolution)
+void Image::parseColorTable(ByteCursor &stream, std::vector<Color> &table, int color_resolution)
 {
     int numColors = 1 << (color_resolution + 1);
+    const uint8_t *colors = stream.ReadBytes(numColors * 3);
+    table.reserve(numColors);
     for (int i = 0; i < numColors; i++)
     {
-        uint8_t color[3];
-        stream.read((char *)color, 3);
-        table.push_back(Color(color[0], color[1], color[2]));
+        table.push_back(Color(colors[i * 3], colors[i * 3 + 1], colors[i * 3 + 2]));
     }
 }
 
 // https://giflib.sourceforge.net/whatsinagif/graphic_control_ext.gif
-void Image::parseGraphicControlExtension(std::ifstream &stream)
+void Image::parseGraphicControlExtension(ByteCursor &stream)
 {
-    // skip block size
-    stream.ignore(1);
-    char block[4];
-    stream.read(block, 4);
-    m_next_delay_ms = littleEndianToBigEndian(block[1], block[2]) * 10;
+    // block size (always 4), packed field, delay, transparent color index
+    // and the block terminator
+    const uint8_t *block = stream.ReadBytes(6);
+    uint8_t packed_field = block[1];
+    m_next_disposal = static_cast<Disposal>((packed_field & 0b00011100) >> 2);
+    if (m_next_disposal > Disposal::PREVIOUS)
+    {
+        m_next_disposal = Disposal::NONE;
+    }
+    m_next_transparent_index = (packed_field & 0b00000001) ? block[4] : -1;
+    m_next_delay_ms = littleEndianToBigEndian(block[2], block[3]) * 10;
 }
 
 // https://giflib.sourceforge.net/whatsinagif/image_descriptor_block.gif
-void Image::parseImageDescriptor(std::ifstream &stream)
+void Image::parseImageDescriptor(ByteCursor &stream)
 {
-    char descriptor_block[10];
-    stream.read(descriptor_block, 10);
+    const uint8_t *descriptor_block = stream.ReadBytes(10);
     Frame frame;
+    frame.left = littleEndianToBigEndian(descriptor_block[1], descriptor_block[2]);
+    frame.top = littleEndianToBigEndian(descriptor_block[3], descriptor_block[4]);
     frame.width = littleEndianToBigEndian(descriptor_block[5], descriptor_block[6]);
     frame.height = littleEndianToBigEndian(descriptor_block[7], descriptor_block[8]);
     uint8_t packed_field = descriptor_block[9];
@@ -383,6 +599,15 @@ void Image::parseImageDescriptor(std::ifstream &stream)
     if (m_next_has_local_color_table)
     {
         frame.color_resolution = packed_field & 0b00000111;
+        if (m_format == PixelFormat::INDEXED)
+        {
+            // The canvas keeps the indices of every frame drawn so far,
+            // but the texture looks them all up in the table of the frame
+            // on screen. That only holds while every frame uses the
+            // global table.
+            LOG_WARN(m_filepath << " has local color tables, it is decoded as RGB");
+            m_format = PixelFormat::RGB;
+        }
     }
     else
     {
@@ -391,175 +616,465 @@ void Image::parseImageDescriptor(std::ifstream &stream)
     }
     frame.interlaced = packed_field & 0b01000000;
     frame.delay_ms = m_next_delay_ms;
+    frame.disposal = m_next_disposal;
+    frame.transparent_index = m_next_transparent_index;
+    // a graphic control extension only applies to the image right after it
+    m_next_delay_ms = 100;
+    m_next_disposal = Disposal::NONE;
+    m_next_transparent_index = -1;
     m_frames.push_back(frame);
 }
 
-void Image::parseImageData(std::ifstream &stream)
+void Image::parseImageData(ByteCursor &stream)
 {
-    u_int8_t lzw_min_code_size;
-    stream.read(reinterpret_cast<char *>(&lzw_min_code_size), 1);
-    uint8_t sub_block_size;
-    stream.read(reinterpret_cast<char *>(&sub_block_size), 1);
-    std::vector<uint8_t> lzw_data;
-    while (sub_block_size != 0x00)
-    {
-        // std::cout << "Read subblock of size " << (int)sub_block_size << "\n";
-        char *block = new char[sub_block_size];
-        stream.read(block, sub_block_size);
-        for (int i = 0; i < sub_block_size; i++)
-        {
-            lzw_data.push_back(block[i]);
-        }
-        delete[] block;
-        stream.read(reinterpret_cast<char *>(&sub_block_size), 1);
-    }
-    std::cout << "Encountered block terminator: " << (int)sub_block_size << "\n";
-    std::cout << "LZW min code size: " << (int)lzw_min_code_size << "\n";
-    std::cout << "LZW data size: " << lzw_data.size() << " bytes\n";
-    std::vector<uint8_t> decompressed_data = decompressLZW(lzw_data, lzw_min_code_size);
-    std::cout << "Decompressed data, result size: " << decompressed_data.size() << " color indices\n";
-    std::vector<uint8_t> rawColorData = mapIndexData(decompressed_data, m_frames.back().color_table);
-    std::cout << "Translated color index data to raw color data\n";
-    std::cout << "Raw color data size: " << rawColorData.size() << " bytes\n";
+    u_int8_t lzw_min_code_size = stream.ReadU8();
+    LOG_TRACE("LZW min code size: " << (int)lzw_min_code_size);
+
     Frame &last_frame = m_frames.back();
-    last_frame.data = rawColorData;
-    if (last_frame.interlaced)
+    if (m_format == PixelFormat::INDEXED)
     {
-        std::cerr << "Interlaced image, not implemented\n";
+        // the GPU palette texture is always 256 entries wide
+        last_frame.color_table.resize(256, Color(0, 0, 0));
     }
+
+    // The sub-blocks stay where they are in the mapped file, only their
+    // extent is recorded. Frames are decoded after the whole file is read.
+    last_frame.lzw_min_code_size = lzw_min_code_size;
+    last_frame.lzw_blocks = stream.GetPointer();
+    size_t start = stream.GetOffset();
+    uint8_t sub_block_size = stream.ReadU8();
+    while (sub_block_size != 0x00)
+    {
+        stream.Skip(sub_block_size);
+        sub_block_size = stream.ReadU8();
+    }
+    last_frame.lzw_blocks_size = stream.GetOffset() - start;
+    LOG_TRACE("Read " << last_frame.lzw_blocks_size << " bytes of image data");
 }
 
-std::vector<uint8_t> Image::mapIndexData(std::vector<uint8_t> data, std::vector<Color> color_table)
+// Feeds the image data sub-blocks of frame to decoder one at a time,
+// straight from the mapped file
+static void decodeSubBlocks(const Frame &frame, FrameWriter &writer)
 {
-    std::vector<uint8_t> mapped_data;
-    for (int i = 0; i < data.size(); i++)
+    LZWDecoder decoder;
+    decoder.Begin(frame.lzw_min_code_size);
+    ByteCursor blocks(frame.lzw_blocks, frame.lzw_blocks_size);
+    uint8_t sub_block_size = blocks.ReadU8();
+    while (sub_block_size != 0x00 && !decoder.Finished())
     {
-        Color color = color_table[data[i]];
-        mapped_data.push_back(color.r);
-        mapped_data.push_back(color.g);
-        mapped_data.push_back(color.b);
+        decoder.Decode(blocks.ReadBytes(sub_block_size), sub_block_size, writer);
+        sub_block_size = blocks.ReadU8();
     }
-    return mapped_data;
 }
 
-// collects codes from bytes and decompresses them to color indices
-// https://giflib.sourceforge.net/whatsinagif/lzw_decoding_bytes.gif
-std::vector<uint8_t> Image::decompressLZW(std::vector<uint8_t> bytes, uint8_t lzw_min_code_size)
+// Hash of a composited frame, which for indexed frames includes the
+// palette the indices are looked up in
+uint64_t Image::frameHash(const uint8_t *pixels, size_t size, const Frame &frame) const
 {
-
-    int cur_code_size = lzw_min_code_size + 1;
-    const int max_code_size = 12;
-    int bit_index = 0;
-    uint16_t clear_code = 1 << lzw_min_code_size;
-    uint16_t end_of_info_code = clear_code + 1;
-
-    std::vector<uint8_t> decompressed_data;
-
-    std::cout << "Initializing code table\n";
-    const uint16_t max_table_size = 1 << 12; // 12-bit maximum for GIF LZW
-    std::vector<std::vector<uint8_t>> code_table((1 << lzw_min_code_size) + 2, std::vector<uint8_t>());
-    for (int i = 0; i < (1 << lzw_min_code_size); ++i)
+    uint64_t hash = HashBytes(pixels, size);
+    if (m_format == PixelFormat::INDEXED)
     {
-        code_table[i] = {static_cast<uint8_t>(i)};
+        hash = hash * 31 + HashBytes(reinterpret_cast<const uint8_t *>(frame.color_table.data()),
+                                     frame.color_table.size() * sizeof(Color));
     }
+    return hash;
+}
 
-    std::cout << "Clear code: " << clear_code << ", End of info code: " << end_of_info_code << "\n";
+bool Image::samePalette(const Frame &a, const Frame &b)
+{
+    return a.color_table.size() == b.color_table.size() &&
+           memcmp(a.color_table.data(), b.color_table.data(), a.color_table.size() * sizeof(Color)) == 0;
+}
 
-    std::cout << "Decompressing LZW data" << std::endl;
-    uint16_t read_clear_code = getNextCode(bytes, bit_index, cur_code_size);
-    if (read_clear_code != clear_code)
-    {
-        throw std::runtime_error("Read clear code does not match expected clear code");
-    }
-    uint16_t prev_code = getNextCode(bytes, bit_index, cur_code_size);
-    if (prev_code >= code_table.size())
+void Image::decodeFrames()
+{
+    // Every frame's LZW data decodes on its own, so that part is spread
+    // over threads. Drawing a frame depends on the frames before it, so
+    // the indices are composited in order afterwards. Frames go through
+    // in batches of a couple per thread, which keeps the threads busy
+    // while only a batch of index buffers is ever held. The threads are
+    // started once and kept for every batch.
+    unsigned threads = m_decode_threads == 0 ? DefaultThreadCount() : m_decode_threads;
+    size_t batch_size = std::min<size_t>(m_frames.size(), static_cast<size_t>(threads) * 2);
+    WorkerGroup workers(static_cast<unsigned>(std::max<size_t>(1, std::min<size_t>(threads, batch_size))));
+    size_t largest = 0;
+    for (const Frame &frame : m_frames)
     {
-        throw std::runtime_error("First code out of range");
+        largest = std::max(largest, static_cast<size_t>(frame.width) * frame.height);
     }
-    // std::cout << prev_code << " ";
-    decompressed_data.insert(decompressed_data.end(), code_table[prev_code].begin(), code_table[prev_code].end());
+    std::vector<std::vector<uint8_t>> indices(batch_size, std::vector<uint8_t>(largest));
+    std::vector<size_t> decoded(batch_size, 0);
 
-    bool just_reset = false;
-    while (bit_index < bytes.size() * 8)
+    // Held poses and ping-pong loops repeat frames, so frames are hashed
+    // and a repeat shares the first copy's data
+    std::unordered_multimap<uint64_t, size_t> seen;
+    // the frame before, only needed for delta storage
+    std::vector<uint8_t> previous;
+    size_t first = 0;
+    auto decodeBatchFrame = [&](size_t j)
+    {
+        const Frame &frame = m_frames[first + j];
+        FrameWriter collector(indices[j].data(), static_cast<size_t>(frame.width) * frame.height);
+        decodeSubBlocks(frame, collector);
+        decoded[j] = collector.GetPixelsWritten();
+    };
+    for (size_t i = 0; i < m_frames.size(); ++i)
     {
-        uint16_t curr_code = getNextCode(bytes, bit_index, cur_code_size);
+        size_t slot = i % batch_size;
+        if (slot == 0)
+        {
+            first = i;
+            workers.Run(std::min(batch_size, m_frames.size() - first), decodeBatchFrame);
+        }
 
-        if (curr_code == clear_code)
+        Frame &frame = m_frames[i];
+        m_compositor.BeginFrame(frame);
+        FrameWriter writer(m_compositor.GetCanvas(), m_width, m_height, frame, m_flip, m_format);
+        // a frame whose data ends early leaves the rest of its rect as it was
+        writer.Write(indices[slot].data(), decoded[slot]);
+        m_compositor.EndFrame(frame);
+        frame.lzw_blocks = nullptr;
+        frame.lzw_blocks_size = 0;
+        if (m_keyframe_interval > 0)
         {
-            code_table.clear();
-            code_table.resize((1 << lzw_min_code_size) + 2, std::vector<uint8_t>());
-            for (int i = 0; i < (1 << lzw_min_code_size); ++i)
+            storeDelta(i, previous);
+            continue;
+        }
+
+        const uint8_t *canvas = m_compositor.GetCanvas();
+        size_t size = m_compositor.GetCanvasSize();
+        uint64_t hash = frameHash(canvas, size, frame);
+        frame.same_as = -1;
+        auto range = seen.equal_range(hash);
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            const Frame &other = m_frames[it->second];
+            if (memcmp(other.data.data(), canvas, size) == 0 &&
+                (m_format != PixelFormat::INDEXED || samePalette(other, frame)))
             {
-                code_table[i] = {static_cast<uint8_t>(i)};
+                frame.same_as = static_cast<int>(it->second);
+                break;
             }
-            cur_code_size = lzw_min_code_size + 1;
-            prev_code = getNextCode(bytes, bit_index, cur_code_size);
-            decompressed_data.insert(decompressed_data.end(), code_table[prev_code].begin(), code_table[prev_code].end());
+        }
+        if (frame.same_as < 0)
+        {
+            frame.data.assign(canvas, canvas + size);
+            seen.emplace(hash, i);
+        }
+    }
+    size_t stored = 0;
+    for (const Frame &frame : m_frames)
+    {
+        stored += frame.data.size();
+    }
+    LOG_INFO("Decoded " << m_frames.size() << " frames, " << GetUniqueFrameCount() << " unique (dedup ratio "
+                        << (m_frames.empty() ? 1.0 : double(m_frames.size()) / GetUniqueFrameCount()) << "), "
+                        << stored << " bytes stored");
+}
+
+// Smallest rect inside r (in storage layout) holding every pixel that
+// differs between before and after, both width * height pixels
+static Rect changedRect(const uint8_t *before, const uint8_t *after, int width, int bytes_per_pixel, const Rect &r)
+{
+    int top = -1;
+    int bottom = -1;
+    int left = r.x + r.width;
+    int right = r.x;
+    size_t row_bytes = static_cast<size_t>(r.width) * bytes_per_pixel;
+    for (int y = r.y; y < r.y + r.height; ++y)
+    {
+        size_t offset = (static_cast<size_t>(y) * width + r.x) * bytes_per_pixel;
+        const uint8_t *a = before + offset;
+        const uint8_t *b = after + offset;
+        if (memcmp(a, b, row_bytes) == 0)
+        {
             continue;
         }
-        else if (curr_code == end_of_info_code)
+        if (top < 0)
         {
-            break;
+            top = y;
+        }
+        bottom = y;
+        // only the columns outside what is already known to change need a look
+        int x = 0;
+        while (r.x + x < left && memcmp(a + x * bytes_per_pixel, b + x * bytes_per_pixel, bytes_per_pixel) == 0)
+        {
+            x++;
+        }
+        left = std::min(left, r.x + x);
+        x = r.width - 1;
+        while (r.x + x >= right && memcmp(a + x * bytes_per_pixel, b + x * bytes_per_pixel, bytes_per_pixel) == 0)
+        {
+            x--;
         }
+        right = std::max(right, r.x + x + 1);
+    }
+    if (top < 0)
+    {
+        return Rect{0, 0, 0, 0};
+    }
+    return Rect{left, top, right - left, bottom - top + 1};
+}
 
-        if (curr_code < code_table.size())
+void Image::storeDelta(size_t index, std::vector<uint8_t> &previous)
+{
+    Frame &frame = m_frames[index];
+    const uint8_t *canvas = m_compositor.GetCanvas();
+    size_t size = m_compositor.GetCanvasSize();
+    int bytes_per_pixel = m_format == PixelFormat::INDEXED ? 1 : 3;
+    frame.same_as = -1;
+    if (index > 0)
+    {
+        // Compositing marks whole frame rects as dirty, shrink that to the
+        // pixels that really changed so deltas and uploads stay small
+        frame.dirty = changedRect(previous.data(), canvas, m_width, bytes_per_pixel, frame.dirty);
+        if (frame.dirty.width == 0 &&
+            (m_format != PixelFormat::INDEXED || samePalette(m_frames[index - 1], frame)))
         {
-            decompressed_data.insert(decompressed_data.end(), code_table[curr_code].begin(), code_table[curr_code].end());
-            int k = code_table[curr_code][0];
-            std::vector<uint8_t> new_entry = code_table[prev_code];
-            new_entry.push_back(k);
-            code_table.push_back(new_entry);
+            frame.same_as = GetFrameContentId(static_cast<int>(index - 1));
         }
-        else
+    }
+
+    if (index % m_keyframe_interval == 0)
+    {
+        frame.data.assign(canvas, canvas + size);
+    }
+    else
+    {
+        // only the changed rect, row after row
+        const Rect &r = frame.dirty;
+        size_t row_bytes = static_cast<size_t>(r.width) * bytes_per_pixel;
+        frame.data.resize(row_bytes * r.height);
+        for (int y = 0; y < r.height; ++y)
         {
-            int k = code_table[prev_code][0];
-            std::vector<uint8_t> new_entry = code_table[prev_code];
-            new_entry.push_back(k);
-            code_table.push_back(new_entry);
-            decompressed_data.insert(decompressed_data.end(), new_entry.begin(), new_entry.end());
+            memcpy(frame.data.data() + y * row_bytes,
+                   canvas + (static_cast<size_t>(r.y + y) * m_width + r.x) * bytes_per_pixel, row_bytes);
         }
+    }
+    frame.data.shrink_to_fit();
+    previous.assign(canvas, canvas + size);
+}
 
-        if (code_table.size() == (2 << (cur_code_size - 1)) && cur_code_size < max_code_size)
+uint8_t *Image::reconstructFrame(int index)
+{
+    int bytes_per_pixel = m_format == PixelFormat::INDEXED ? 1 : 3;
+    int keyframe = index - index % m_keyframe_interval;
+    if (m_delta_index == index)
+    {
+        return m_delta_canvas.data();
+    }
+    // Playing forwards only applies the next delta, anything else starts
+    // over from the keyframe
+    int start = m_delta_index;
+    if (start < keyframe || start > index)
+    {
+        m_delta_canvas = m_frames[keyframe].data;
+        start = keyframe;
+    }
+    for (int i = start + 1; i <= index; ++i)
+    {
+        const Frame &frame = m_frames[i];
+        const Rect &r = frame.dirty;
+        size_t row_bytes = static_cast<size_t>(r.width) * bytes_per_pixel;
+        for (int y = 0; y < r.height; ++y)
         {
-            cur_code_size++;
+            memcpy(m_delta_canvas.data() + (static_cast<size_t>(r.y + y) * m_width + r.x) * bytes_per_pixel,
+                   frame.data.data() + y * row_bytes, row_bytes);
         }
+    }
+    m_delta_index = index;
+    return m_delta_canvas.data();
+}
 
-        prev_code = curr_code;
+size_t Image::GetUniqueFrameCount() const
+{
+    size_t unique = 0;
+    for (const Frame &frame : m_frames)
+    {
+        if (frame.same_as < 0)
+        {
+            unique++;
+        }
     }
-    std::cout << "Total codes: " << code_table.size() << std::endl;
+    return unique;
+}
+
+void Image::SetLazyDecoding(size_t cache_budget_bytes)
+{
+    m_lazy = true;
+    m_frame_cache.SetBudget(cache_budget_bytes);
+}
 
-    return decompressed_data;
+void Image::SetDecodeAhead(size_t frames)
+{
+    m_lazy = true;
+    m_decode_ahead = frames;
 }
 
-uint16_t Image::getNextCode(std::vector<uint8_t> bytes, int &bit_index, int cur_code_size)
+uint8_t *Image::frameData(int index)
 {
-    int byte_index, bit_byte_index;
-    uint16_t code = 0;
-    int bit_pos = 0;
-    for (int i = 0; i < cur_code_size; i++)
+    if (m_prefetcher.IsRunning())
     {
-        byte_index = bit_index / 8;
-        bit_byte_index = bit_index % 8;
-        uint8_t bit = (bytes[byte_index] >> bit_byte_index) & 0b00000001;
-        code = code | (bit << bit_pos);
-        bit_pos++;
-        // also increase the bit_index var!!
-        bit_index++;
+        // the worker keeps the frame on screen in the ring
+        return const_cast<uint8_t *>(m_prefetcher.Current().pixels.data());
     }
-    if (code > 4095)
+    if (!m_lazy)
     {
-        throw std::runtime_error("Invalid code size encountered: " + std::to_string(code));
+        if (m_keyframe_interval > 0)
+        {
+            return reconstructFrame(index);
+        }
+        Frame &frame = m_frames[GetFrameContentId(index)];
+        if (frame.mapped_data != nullptr)
+        {
+            // cache files are mapped read only, callers never write to it
+            return const_cast<uint8_t *>(frame.mapped_data);
+        }
+        return frame.data.data();
+    }
+    try
+    {
+        return decodeFrame(index);
+    }
+    catch (const std::runtime_error &e)
+    {
+        LOG_ERROR("Failed to decode GIF frame " << index << ": " << e.what());
+        exit(1);
     }
-    return code;
+}
+
+uint8_t *Image::decodeFrame(int index)
+{
+    uint8_t *cached = m_frame_cache.Find(index);
+    if (cached != nullptr)
+    {
+        return cached;
+    }
+    // A frame depends on every frame before it, so going back means
+    // compositing again from the first frame. Playing forwards only ever
+    // draws the one new frame.
+    if (index <= m_composited_index)
+    {
+        m_compositor.Restart();
+        m_composited_index = -1;
+    }
+    while (m_composited_index < index)
+    {
+        Frame &frame = m_frames[++m_composited_index];
+        m_compositor.BeginFrame(frame);
+        FrameWriter writer(m_compositor.GetCanvas(), m_width, m_height, frame, m_flip, m_format);
+        decodeSubBlocks(frame, writer);
+        m_compositor.EndFrame(frame);
+    }
+    return m_frame_cache.Insert(index, m_compositor.GetCanvas(), m_compositor.GetCanvasSize());
+}
+
+const std::vector<double> &Image::GetFrameEndTimesMs()
+{
+    if (m_frame_end_ms.size() != m_frames.size())
+    {
+        m_frame_end_ms.clear();
+        double end = 0.0;
+        for (const Frame &frame : m_frames)
+        {
+            end += ShownDelayMs(frame.delay_ms);
+            m_frame_end_ms.push_back(end);
+        }
+    }
+    return m_frame_end_ms;
+}
+
+double Image::GetPlaybackTimeMs() const
+{
+    return m_start_time_ms < 0.0 ? 0.0 : m_clock->GetTimeMs() - m_start_time_ms;
+}
+
+int Image::frameAtTime(double elapsed_ms)
+{
+    double loop_ms = GetFrameEndTimesMs().back();
+    double into_loop = std::fmod(elapsed_ms, loop_ms);
+    size_t index = std::upper_bound(m_frame_end_ms.begin(), m_frame_end_ms.end(), into_loop) - m_frame_end_ms.begin();
+    return static_cast<int>(std::min(index, m_frames.size() - 1));
 }
 
 void Image::updateFrame()
 {
-    if (SDL_GetTicks() - m_last_refresh_time_ms > m_frames[m_cur_frame_index].delay_ms)
+    if (m_frames.empty())
+    {
+        return;
+    }
+    double now = m_clock->GetTimeMs();
+    if (m_start_time_ms < 0.0)
+    {
+        m_start_time_ms = now;
+    }
+    // The frame comes from the time played so far rather than stepping one
+    // frame per call, so playback keeps its speed when calls come late
+    int target = frameAtTime(now - m_start_time_ms);
+    m_cur_loop = static_cast<long long>((now - m_start_time_ms) / m_frame_end_ms.back());
+    if (m_prefetcher.IsRunning())
+    {
+        // The worker decodes frames in order, frames that are already late
+        // are passed over. Move on only as far as the worker has frames
+        // ready, a late frame stays on screen a little longer rather than
+        // blocking.
+        for (size_t step = 0; step < m_frames.size() && m_cur_frame_index != target; ++step)
+        {
+            if (!m_prefetcher.Advance())
+            {
+                break;
+            }
+            checkPrefetched(m_prefetcher.Current());
+            m_cur_frame_index = m_prefetcher.Current().index;
+        }
+        return;
+    }
+    m_cur_frame_index = target;
+}
+
+uint8_t *Image::PeekFrame(int index, Rect &dirty)
+{
+    if (index < 0 || index >= static_cast<int>(m_frames.size()))
+    {
+        return nullptr;
+    }
+    if (m_prefetcher.IsRunning())
+    {
+        const PrefetchedFrame *next = m_prefetcher.Peek();
+        // a frame that failed is reported once it is due
+        if (next == nullptr || next->index != index || !next->error.empty())
+        {
+            return nullptr;
+        }
+        dirty = next->dirty;
+        return const_cast<uint8_t *>(next->pixels.data());
+    }
+    // frames decoded on demand get their dirty rect while decoding
+    uint8_t *pixels = frameData(index);
+    dirty = m_frames[index].dirty;
+    return pixels;
+}
+
+double Image::GetNextFrameTimeMs()
+{
+    if (m_frames.size() <= 1)
+    {
+        return std::numeric_limits<double>::infinity();
+    }
+    double now = m_clock->GetTimeMs();
+    if (m_start_time_ms < 0.0)
+    {
+        // not playing yet, the first frame is due now
+        return now;
+    }
+    double elapsed = now - m_start_time_ms;
+    if (frameAtTime(elapsed) != m_cur_frame_index)
     {
-        m_cur_frame_index = (m_cur_frame_index + 1) % m_frames.size();
-        m_last_refresh_time_ms = SDL_GetTicks();
+        // behind, waiting for decode ahead to catch up
+        return now;
     }
+    double loop_start = now - std::fmod(elapsed, m_frame_end_ms.back());
+    return loop_start + m_frame_end_ms[m_cur_frame_index];
 }
 
 /*  ===============================================
@@ -594,11 +1109,17 @@ Post-condition:
 =============================================== */
 void Image::PrintPixels()
 {
-    for (int x = 0; x < m_width * m_height * 3; ++x)
+    // a few values per message, long ones would be cut short
+    const int per_message = 48;
+    for (int start = 0; start < m_width * m_height * 3; start += per_message)
     {
-        std::cout << " " << (int)m_pixelData[x];
+        std::ostringstream values;
+        for (int x = start; x < std::min(start + per_message, m_width * m_height * 3); ++x)
+        {
+            values << " " << (int)m_pixelData[x];
+        }
+        LOG_DEBUG(values.str());
     }
-    std::cout << "\n";
 }
 
 /*  ===============================================
@@ -610,19 +1131,51 @@ uint8_t *Image::GetPixelDataPtr()
 {
     if (m_filepath.substr(m_filepath.find_last_of(".") + 1) == "ppm")
     {
-        std::cout << "Returning pixel data for a PPM image" << std::endl;
         return m_pixelData;
     }
     else if (m_filepath.substr(m_filepath.find_last_of(".") + 1) == "gif")
     {
-        std::cout << "Returning pixel data for a GIF" << std::endl;
         updateFrame();
-        std::cout << "Current frame index: " << m_cur_frame_index << std::endl;
-        return m_frames[m_cur_frame_index].data.data();
+        LOG_TRACE("Current frame index: " << m_cur_frame_index);
+        return frameData(m_cur_frame_index);
     }
     else
     {
-        std::cout << "Unsupported file type" << std::endl;
+        LOG_ERROR("Unsupported file type");
+        return nullptr;
+    }
+}
+
+/*  ===============================================
+Desc: Returns the region of the current frame that differs from the
+      frame before it
+Precondition:
+Post-condition:
+=============================================== */
+Rect Image::GetDirtyRect()
+{
+    if (m_frames.empty())
+    {
+        return Rect{0, 0, m_width, m_height};
+    }
+    if (m_prefetcher.IsRunning())
+    {
+        // the worker writes dirty rects of frames it is still decoding
+        return m_prefetcher.Current().dirty;
+    }
+    return m_frames[m_cur_frame_index].dirty;
+}
+
+/*  ===============================================
+Desc: Returns the color table of the current frame
+Precondition: image was loaded with PixelFormat::INDEXED
+Post-condition:
+=============================================== */
+uint8_t *Image::GetPaletteDataPtr()
+{
+    if (m_format != PixelFormat::INDEXED || m_frames.empty())
+    {
         return nullptr;
     }
+    return reinterpret_cast<uint8_t *>(m_frames[m_cur_frame_index].color_table.data());
 }
\ No newline at end of file
@@ -0,0 +1,122 @@
+#include "LZWDecoder.hpp"
+#include "FrameWriter.hpp"
+
+#include <stdexcept>
+#include <string>
+
+// https://giflib.sourceforge.net/whatsinagif/lzw_decoding_bytes.gif
+
+void LZWDecoder::Begin(uint8_t lzw_min_code_size)
+{
+    if (lzw_min_code_size < 2 || lzw_min_code_size > 8)
+    {
+        throw std::runtime_error("Invalid LZW min code size: " + std::to_string(lzw_min_code_size));
+    }
+    m_minCodeSize = lzw_min_code_size;
+    m_codeSize = m_minCodeSize + 1;
+    m_clearCode = 1 << m_minCodeSize;
+    m_endOfInfoCode = m_clearCode + 1;
+    m_nextCode = m_endOfInfoCode + 1;
+    m_prevCode = NO_CODE;
+    m_finished = false;
+    m_reader.Reset();
+    for (uint16_t i = 0; i < m_clearCode; ++i)
+    {
+        m_prefix[i] = NO_CODE;
+        m_suffix[i] = static_cast<uint8_t>(i);
+        m_length[i] = 1;
+    }
+}
+
+bool LZWDecoder::Decode(const uint8_t *data, size_t size, FrameWriter &writer)
+{
+    if (m_finished)
+    {
+        return true;
+    }
+    m_reader.SetInput(data, size);
+
+    // a code that straddles the end of this sub-block stays buffered in the
+    // reader until the next one arrives
+    while (m_reader.CanRead(m_codeSize))
+    {
+        uint16_t curr_code = m_reader.ReadBits(m_codeSize);
+
+        if (curr_code == m_clearCode)
+        {
+            m_nextCode = m_endOfInfoCode + 1;
+            m_codeSize = m_minCodeSize + 1;
+            m_prevCode = NO_CODE;
+            continue;
+        }
+        else if (curr_code == m_endOfInfoCode)
+        {
+            m_finished = true;
+            break;
+        }
+
+        if (m_prevCode == NO_CODE)
+        {
+            // first code after a clear is always a literal and adds no entry
+            if (curr_code >= m_clearCode)
+            {
+                throw std::runtime_error("First code out of range");
+            }
+            writer.Write(&m_suffix[curr_code], 1);
+            m_prevCode = curr_code;
+            continue;
+        }
+
+        uint16_t code = curr_code;
+        int length;
+        if (curr_code < m_nextCode)
+        {
+            length = m_length[code];
+        }
+        else if (curr_code == m_nextCode)
+        {
+            // KwKwK case: the string is prev + first byte of prev, which is not
+            // in the table yet
+            code = m_prevCode;
+            length = m_length[code] + 1;
+        }
+        else
+        {
+            throw std::runtime_error("Invalid LZW code encountered: " + std::to_string(curr_code));
+        }
+
+        // walk the prefix chain writing the string backwards into the end of
+        // the scratch buffer, then hand the whole run to the writer
+        uint8_t *out = m_string + MAX_TABLE_SIZE - length;
+        for (int i = m_length[code] - 1; i >= 0; --i)
+        {
+            out[i] = m_suffix[code];
+            code = m_prefix[code];
+        }
+        uint8_t first = out[0];
+        if (curr_code == m_nextCode)
+        {
+            out[length - 1] = first;
+        }
+        writer.Write(out, length);
+
+        // once the table is full the encoder may keep emitting 12-bit codes
+        // without a clear (deferred clear), so we simply stop adding entries
+        if (m_nextCode < MAX_TABLE_SIZE)
+        {
+            m_prefix[m_nextCode] = m_prevCode;
+            m_suffix[m_nextCode] = first;
+            m_length[m_nextCode] = m_length[m_prevCode] + 1;
+            m_nextCode++;
+            if (m_nextCode == (1 << m_codeSize) && m_codeSize < MAX_CODE_SIZE)
+            {
+                m_codeSize++;
+            }
+        }
+
+        m_prevCode = curr_code;
+    }
+    // the caller reuses its sub-block buffer, so keep any leftover bits
+    m_reader.ReleaseInput();
+    return m_finished;
+}
@@ -0,0 +1,169 @@
+#include "Log.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+
+// must be a power of two
+static const size_t SLOT_COUNT = 1024;
+// longer messages are cut short
+static const size_t MESSAGE_BYTES = 240;
+
+struct LogSlot
+{
+    // equals the write position the slot is free for, or that position + 1
+    // once its message is ready to be read
+    std::atomic<size_t> sequence{0};
+    LogLevel level{LogLevel::INFO};
+    size_t length{0};
+    char text[MESSAGE_BYTES];
+};
+
+struct LogRing
+{
+    LogSlot slots[SLOT_COUNT];
+    std::atomic<size_t> head{0};
+    // only touched by Flush, under flush_mutex
+    size_t tail{0};
+    std::mutex flush_mutex;
+    std::atomic<int> level{static_cast<int>(LogLevel::INFO)};
+    std::atomic<size_t> dropped{0};
+    size_t reported_dropped{0};
+
+    LogRing()
+    {
+        for (size_t i = 0; i < SLOT_COUNT; ++i)
+        {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+};
+
+static void flushAtExit()
+{
+    Log::Flush();
+}
+
+static LogRing &ring()
+{
+    static LogRing instance;
+    // registered after instance is built, so it runs before instance goes
+    static const bool registered = (std::atexit(flushAtExit), true);
+    (void)registered;
+    return instance;
+}
+
+static const char *levelName(LogLevel level)
+{
+    switch (level)
+    {
+    case LogLevel::TRACE:
+        return "trace";
+    case LogLevel::DEBUG:
+        return "debug";
+    case LogLevel::INFO:
+        return "info";
+    case LogLevel::WARN:
+        return "warn";
+    default:
+        return "error";
+    }
+}
+
+void Log::SetLevel(LogLevel level)
+{
+    ring().level.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+LogLevel Log::GetLevel()
+{
+    return static_cast<LogLevel>(ring().level.load(std::memory_order_relaxed));
+}
+
+bool Log::Enabled(LogLevel level)
+{
+    return static_cast<int>(level) >= ring().level.load(std::memory_order_relaxed);
+}
+
+void Log::Write(LogLevel level, const std::string &message)
+{
+    LogRing &r = ring();
+    size_t position = r.head.load(std::memory_order_relaxed);
+    LogSlot *slot;
+    while (true)
+    {
+        slot = &r.slots[position & (SLOT_COUNT - 1)];
+        size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+        if (difference == 0)
+        {
+            if (r.head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (difference < 0)
+        {
+            // the slot still holds a message from the last lap, the ring is full
+            r.dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        else
+        {
+            position = r.head.load(std::memory_order_relaxed);
+        }
+    }
+    slot->level = level;
+    slot->length = message.size() < MESSAGE_BYTES ? message.size() : MESSAGE_BYTES;
+    memcpy(slot->text, message.data(), slot->length);
+    slot->sequence.store(position + 1, std::memory_order_release);
+
+    if (level >= LogLevel::WARN)
+    {
+        Flush();
+    }
+}
+
+void Log::Flush()
+{
+    LogRing &r = ring();
+    std::lock_guard<std::mutex> lock(r.flush_mutex);
+    bool wrote = false;
+    bool wrote_error = false;
+    while (true)
+    {
+        LogSlot &slot = r.slots[r.tail & (SLOT_COUNT - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != r.tail + 1)
+        {
+            break;
+        }
+        FILE *out = slot.level >= LogLevel::WARN ? stderr : stdout;
+        wrote = true;
+        wrote_error = wrote_error || out == stderr;
+        fprintf(out, "[%s] %.*s\n", levelName(slot.level), static_cast<int>(slot.length), slot.text);
+        slot.sequence.store(r.tail + SLOT_COUNT, std::memory_order_release);
+        r.tail++;
+    }
+    size_t dropped = r.dropped.load(std::memory_order_relaxed);
+    if (dropped != r.reported_dropped)
+    {
+        fprintf(stderr, "[warn] %zu log messages dropped\n", dropped - r.reported_dropped);
+        r.reported_dropped = dropped;
+    }
+    if (wrote)
+    {
+        fflush(stdout);
+    }
+    if (wrote_error)
+    {
+        fflush(stderr);
+    }
+}
+
+size_t Log::GetDropped()
+{
+    return ring().dropped.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,225 @@
+#include "MipChain.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MIP_CHAIN_X86
+#include <immintrin.h>
+#endif
+
+int MipLevelCount(int width, int height)
+{
+    int levels = 0;
+    while (width > 1 || height > 1)
+    {
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+        levels++;
+    }
+    return levels;
+}
+
+// sRGB bytes to linear light and back. Going back picks the nearest byte,
+// so averaging four equal pixels gives the same byte again.
+struct SRGBTables
+{
+    float to_linear[256];
+    // halfway between the linear values of neighbouring bytes
+    float midpoints[256];
+    // nearest byte to the bottom of each of 4096 even steps of linear
+    // light, a search for the nearest byte starts there
+    uint8_t search_start[4096];
+
+    SRGBTables()
+    {
+        for (int i = 0; i < 256; ++i)
+        {
+            float c = i / 255.0f;
+            to_linear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        for (int i = 0; i < 255; ++i)
+        {
+            midpoints[i] = 0.5f * (to_linear[i] + to_linear[i + 1]);
+        }
+        // nothing rounds past the last byte
+        midpoints[255] = 2.0f;
+        for (int i = 0; i < 4096; ++i)
+        {
+            search_start[i] = static_cast<uint8_t>(
+                std::upper_bound(midpoints, midpoints + 255, i / 4095.0f) - midpoints);
+        }
+    }
+
+    // Bytes are further apart than the steps everywhere but in the
+    // darkest few, so this takes one or two steps at most
+    inline uint8_t toSRGB(float linear) const
+    {
+        int byte = search_start[static_cast<int>(linear * 4095.0f)];
+        while (linear > midpoints[byte])
+        {
+            byte++;
+        }
+        return static_cast<uint8_t>(byte);
+    }
+};
+
+static const SRGBTables &srgbTables()
+{
+    static const SRGBTables tables;
+    return tables;
+}
+
+void DownsampleRGBAScalar(const uint8_t *rgba, int width, int height, bool gamma_correct, uint8_t *dest)
+{
+    int out_width = std::max(1, width / 2);
+    int out_height = std::max(1, height / 2);
+    const SRGBTables &tables = srgbTables();
+    for (int y = 0; y < out_height; ++y)
+    {
+        // a side that is one pixel wide already just repeats its pixel
+        const uint8_t *row0 = rgba + static_cast<size_t>(2 * y) * width * 4;
+        const uint8_t *row1 = rgba + static_cast<size_t>(std::min(2 * y + 1, height - 1)) * width * 4;
+        for (int x = 0; x < out_width; ++x)
+        {
+            int x0 = 2 * x * 4;
+            int x1 = std::min(2 * x + 1, width - 1) * 4;
+            for (int c = 0; c < 4; ++c)
+            {
+                if (gamma_correct && c < 3)
+                {
+                    float sum = tables.to_linear[row0[x0 + c]] + tables.to_linear[row0[x1 + c]] +
+                                tables.to_linear[row1[x0 + c]] + tables.to_linear[row1[x1 + c]];
+                    dest[c] = tables.toSRGB(sum * 0.25f);
+                }
+                else
+                {
+                    // alpha is coverage, it always averages as is
+                    dest[c] =
+                        static_cast<uint8_t>((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) >> 2);
+                }
+            }
+            dest += 4;
+        }
+    }
+}
+
+#ifdef MIP_CHAIN_X86
+
+// Averages 4 output pixels per step from 8 pixels of each source row.
+// The gamma correct filter is table lookups per channel, which SSE2 has
+// no gather for, so it stays scalar.
+__attribute__((target("sse2"))) static void downsampleSSE2(const uint8_t *rgba, int width, int height,
+                                                           bool gamma_correct, uint8_t *dest)
+{
+    if (gamma_correct || width < 2)
+    {
+        DownsampleRGBAScalar(rgba, width, height, gamma_correct, dest);
+        return;
+    }
+    int out_width = width / 2;
+    int out_height = std::max(1, height / 2);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi16(2);
+    for (int y = 0; y < out_height; ++y)
+    {
+        const uint8_t *row0 = rgba + static_cast<size_t>(2 * y) * width * 4;
+        const uint8_t *row1 = rgba + static_cast<size_t>(std::min(2 * y + 1, height - 1)) * width * 4;
+        uint8_t *out = dest + static_cast<size_t>(y) * out_width * 4;
+        int x = 0;
+        for (; x + 4 <= out_width; x += 4)
+        {
+            __m128i sums[2];
+            for (int half = 0; half < 2; ++half)
+            {
+                // 4 source pixels across both rows, widened to 16 bits
+                __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row0 + (2 * x + 4 * half) * 4));
+                __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row1 + (2 * x + 4 * half) * 4));
+                __m128i low = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+                __m128i high = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+                // pixels 0 and 2 in one register, 1 and 3 in the other,
+                // so one add finishes both 2x2 sums
+                __m128i even = _mm_unpacklo_epi64(low, high);
+                __m128i odd = _mm_unpackhi_epi64(low, high);
+                sums[half] = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(even, odd), round), 2);
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + x * 4), _mm_packus_epi16(sums[0], sums[1]));
+        }
+        for (; x < out_width; ++x)
+        {
+            const uint8_t *p0 = row0 + 2 * x * 4;
+            const uint8_t *p1 = row1 + 2 * x * 4;
+            for (int c = 0; c < 4; ++c)
+            {
+                out[x * 4 + c] = static_cast<uint8_t>((p0[c] + p0[4 + c] + p1[c] + p1[4 + c] + 2) >> 2);
+            }
+        }
+    }
+}
+
+#endif
+
+typedef void (*DownsampleFunction)(const uint8_t *, int, int, bool, uint8_t *);
+
+struct MipKernel
+{
+    DownsampleFunction downsample;
+    const char *name;
+};
+
+// Picks the widest kernel the CPU supports, once
+static const MipKernel &kernel()
+{
+    static const MipKernel selected = []()
+    {
+#ifdef MIP_CHAIN_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("sse2"))
+        {
+            return MipKernel{downsampleSSE2, "sse2"};
+        }
+#endif
+        return MipKernel{DownsampleRGBAScalar, "scalar"};
+    }();
+    return selected;
+}
+
+void DownsampleRGBA(const uint8_t *rgba, int width, int height, bool gamma_correct, uint8_t *dest)
+{
+    kernel().downsample(rgba, width, height, gamma_correct, dest);
+}
+
+const char *MipKernelName()
+{
+    return kernel().name;
+}
+
+void BuildMipChain(const uint8_t *rgba, int width, int height, bool gamma_correct, MipChain &chain)
+{
+    chain.levels.resize(MipLevelCount(width, height));
+    size_t bytes = 0;
+    int level_width = width;
+    int level_height = height;
+    for (MipLevel &level : chain.levels)
+    {
+        level_width = std::max(1, level_width / 2);
+        level_height = std::max(1, level_height / 2);
+        level.width = level_width;
+        level.height = level_height;
+        level.offset = bytes;
+        bytes += static_cast<size_t>(level_width) * level_height * 4;
+    }
+    chain.pixels.resize(bytes);
+
+    const uint8_t *source = rgba;
+    int source_width = width;
+    int source_height = height;
+    for (const MipLevel &level : chain.levels)
+    {
+        uint8_t *dest = chain.pixels.data() + level.offset;
+        DownsampleRGBA(source, source_width, source_height, gamma_correct, dest);
+        source = dest;
+        source_width = level.width;
+        source_height = level.height;
+    }
+}
@@ -8,6 +8,7 @@
 
 // header
 #include <OBJModel.hpp>
+#include <Log.hpp>
 
 // C++ Standard Template Library (STL)
 #include <iostream>
@@ -27,7 +28,7 @@ OBJModel::OBJModel(const std::string &filename)
     std::ifstream file(filename);
     if (!file.is_open())
     {
-        std::cerr << "Could not open file: " << filename << std::endl;
+        LOG_ERROR("Could not open file: " << filename);
         exit(1);
     }
     std::string line;
@@ -166,7 +167,7 @@ void OBJModel::handleFaceString(std::string faceString)
 
 void OBJModel::handleMaterialLib(std::string materialFilename) {
     std::string materialPath = mDirectoryPath + "/" + materialFilename;
-    std::cout << "Material path: " << materialPath << std::endl;
+    LOG_INFO("Material path: " << materialPath);
     std::ifstream materialFile(materialPath);
     mTextureFilename = "";
     mNormalMapFilename = "";
@@ -180,23 +181,23 @@ void OBJModel::handleMaterialLib(std::string materialFilename) {
                 int spaceIndex = line.find(" ");
                 std::string partialFilename = line.substr(spaceIndex + 1);
                 mTextureFilename = mDirectoryPath + "/" + partialFilename;
-                std::cout << "Texture filename: " << mTextureFilename << std::endl;
+                LOG_INFO("Texture filename: " << mTextureFilename);
             } else if (line.find("map_Bump") != std::string::npos) {
                 int spaceIndex = line.find(" ");
                 std::string partialFilename = line.substr(spaceIndex + 1);
                 mNormalMapFilename = mDirectoryPath + "/" + partialFilename;
-                std::cout << "Normal map filename: " << mNormalMapFilename << std::endl;
+                LOG_INFO("Normal map filename: " << mNormalMapFilename);
             }
         }
         if (mTextureFilename == "") {
-            std::cerr << "Could not find texture filename in material file: " << materialFilename << std::endl;
+            LOG_ERROR("Could not find texture filename in material file: " << materialFilename);
             exit(1);
         } else if (mNormalMapFilename == "") {
-            std::cerr << "Could not find normal map filename in material file: " << materialFilename << std::endl;
+            LOG_ERROR("Could not find normal map filename in material file: " << materialFilename);
             exit(1);
         }
     } else {
-        std::cerr << "Could not open material file: " << materialPath << std::endl;
+        LOG_ERROR("Could not open material file: " << materialPath);
         exit(1);
     }
 }
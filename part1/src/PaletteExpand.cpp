@@ -0,0 +1,168 @@
+#include "PaletteExpand.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define PALETTE_EXPAND_X86
+#include <immintrin.h>
+#endif
+
+void PackPalette(const std::vector<Color> &color_table, uint32_t *palette)
+{
+    size_t colors = color_table.size() < 256 ? color_table.size() : 256;
+    for (size_t i = 0; i < 256; ++i)
+    {
+        palette[i] = 0xFF000000u;
+    }
+    for (size_t i = 0; i < colors; ++i)
+    {
+        palette[i] = uint32_t(color_table[i].r) | (uint32_t(color_table[i].g) << 8) |
+                     (uint32_t(color_table[i].b) << 16) | 0xFF000000u;
+    }
+}
+
+void ExpandPaletteRGBScalar(const uint8_t *indices, size_t count, const uint32_t *palette, uint8_t *dest)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        uint32_t color = palette[indices[i]];
+        dest[0] = static_cast<uint8_t>(color);
+        dest[1] = static_cast<uint8_t>(color >> 8);
+        dest[2] = static_cast<uint8_t>(color >> 16);
+        dest += 3;
+    }
+}
+
+void ExpandPaletteRGBAScalar(const uint8_t *indices, size_t count, const uint32_t *palette, uint8_t *dest)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        uint32_t color = palette[indices[i]];
+        dest[0] = static_cast<uint8_t>(color);
+        dest[1] = static_cast<uint8_t>(color >> 8);
+        dest[2] = static_cast<uint8_t>(color >> 16);
+        dest[3] = static_cast<uint8_t>(color >> 24);
+        dest += 4;
+    }
+}
+
+#ifdef PALETTE_EXPAND_X86
+
+// SSE2 has no gather or byte shuffle, so four palette entries are loaded
+// with scalar loads and the 24-bit packing is done with 64-bit shifts.
+__attribute__((target("sse2"))) static void expandRGBSSE2(const uint8_t *indices, size_t count, const uint32_t *palette, uint8_t *dest)
+{
+    const __m128i rgb_mask = _mm_set1_epi32(0x00FFFFFF);
+    const __m128i low_qword = _mm_set_epi32(0, 0, -1, -1);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i pixels = _mm_set_epi32(palette[indices[i + 3]], palette[indices[i + 2]],
+                                       palette[indices[i + 1]], palette[indices[i]]);
+        pixels = _mm_and_si128(pixels, rgb_mask);
+        // in each 64-bit half, move the odd pixel down next to the even one
+        __m128i even = _mm_and_si128(pixels, _mm_set_epi32(0, -1, 0, -1));
+        __m128i odd = _mm_srli_epi64(pixels, 32);
+        __m128i pairs = _mm_or_si128(even, _mm_slli_epi64(odd, 24));
+        // pairs now holds 6 bytes in each half, close the 2 byte gap
+        __m128i packed = _mm_or_si128(_mm_and_si128(pairs, low_qword),
+                                      _mm_srli_si128(_mm_andnot_si128(low_qword, pairs), 2));
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(dest), packed);
+        uint32_t tail = static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_srli_si128(packed, 8)));
+        dest[8] = static_cast<uint8_t>(tail);
+        dest[9] = static_cast<uint8_t>(tail >> 8);
+        dest[10] = static_cast<uint8_t>(tail >> 16);
+        dest[11] = static_cast<uint8_t>(tail >> 24);
+        dest += 12;
+    }
+    ExpandPaletteRGBScalar(indices + i, count - i, palette, dest);
+}
+
+__attribute__((target("sse2"))) static void expandRGBASSE2(const uint8_t *indices, size_t count, const uint32_t *palette, uint8_t *dest)
+{
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i pixels = _mm_set_epi32(palette[indices[i + 3]], palette[indices[i + 2]],
+                                       palette[indices[i + 1]], palette[indices[i]]);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dest), pixels);
+        dest += 16;
+    }
+    ExpandPaletteRGBAScalar(indices + i, count - i, palette, dest);
+}
+
+// AVX2 gathers eight palette entries at once
+__attribute__((target("avx2"))) static inline __m256i gather8(const uint8_t *indices, const uint32_t *palette)
+{
+    __m256i idx = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(indices)));
+    return _mm256_i32gather_epi32(reinterpret_cast<const int *>(palette), idx, 4);
+}
+
+__attribute__((target("avx2"))) static void expandRGBAVX2(const uint8_t *indices, size_t count, const uint32_t *palette, uint8_t *dest)
+{
+    // drop the alpha byte of each pixel within a lane, then move the two
+    // 12 byte halves next to each other
+    const __m256i pack = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+                                          0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    const __m256i join = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256i pixels = _mm256_shuffle_epi8(gather8(indices + i, palette), pack);
+        pixels = _mm256_permutevar8x32_epi32(pixels, join);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dest), _mm256_castsi256_si128(pixels));
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(dest + 16), _mm256_extracti128_si256(pixels, 1));
+        dest += 24;
+    }
+    ExpandPaletteRGBScalar(indices + i, count - i, palette, dest);
+}
+
+__attribute__((target("avx2"))) static void expandRGBAAVX2(const uint8_t *indices, size_t count, const uint32_t *palette, uint8_t *dest)
+{
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dest), gather8(indices + i, palette));
+        dest += 32;
+    }
+    ExpandPaletteRGBAScalar(indices + i, count - i, palette, dest);
+}
+
+#endif
+
+std::vector<PaletteExpandKernel> PaletteExpandKernels()
+{
+    std::vector<PaletteExpandKernel> available{{ExpandPaletteRGBScalar, ExpandPaletteRGBAScalar, "scalar"}};
+#ifdef PALETTE_EXPAND_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2"))
+    {
+        available.push_back(PaletteExpandKernel{expandRGBSSE2, expandRGBASSE2, "sse2"});
+    }
+    if (__builtin_cpu_supports("avx2"))
+    {
+        available.push_back(PaletteExpandKernel{expandRGBAVX2, expandRGBAAVX2, "avx2"});
+    }
+#endif
+    return available;
+}
+
+// Picks the widest kernel the CPU supports, once
+static const PaletteExpandKernel &kernels()
+{
+    static const PaletteExpandKernel selected = PaletteExpandKernels().back();
+    return selected;
+}
+
+void ExpandPaletteRGB(const uint8_t *indices, size_t count, const uint32_t *palette, uint8_t *dest)
+{
+    kernels().rgb(indices, count, palette, dest);
+}
+
+void ExpandPaletteRGBA(const uint8_t *indices, size_t count, const uint32_t *palette, uint8_t *dest)
+{
+    kernels().rgba(indices, count, palette, dest);
+}
+
+const char *PaletteExpandKernelName()
+{
+    return kernels().name;
+}
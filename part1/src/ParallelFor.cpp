@@ -0,0 +1,93 @@
+#include "ParallelFor.hpp"
+
+WorkerGroup::WorkerGroup(unsigned threads)
+{
+    if (threads == 0)
+    {
+        threads = DefaultThreadCount();
+    }
+    for (unsigned t = 1; t < threads; ++t)
+    {
+        m_workers.emplace_back(&WorkerGroup::workerLoop, this);
+    }
+}
+
+WorkerGroup::~WorkerGroup()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (std::thread &worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+void WorkerGroup::run(size_t count, JobFunction function, void *job)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_count = count;
+        m_function = function;
+        m_job = job;
+        m_next = 0;
+        m_error = nullptr;
+        m_busy = m_workers.size();
+        ++m_round;
+    }
+    m_wake.notify_all();
+    work();
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this]() { return m_busy == 0; });
+    if (m_error)
+    {
+        std::exception_ptr error = m_error;
+        m_error = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+void WorkerGroup::work()
+{
+    for (size_t i = m_next++; i < m_count; i = m_next++)
+    {
+        try
+        {
+            m_function(m_job, i);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_error)
+            {
+                m_error = std::current_exception();
+            }
+            m_next = m_count;
+        }
+    }
+}
+
+void WorkerGroup::workerLoop()
+{
+    uint64_t round = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this, round]() { return m_stop || m_round != round; });
+            if (m_stop)
+            {
+                return;
+            }
+            round = m_round;
+        }
+        work();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (--m_busy == 0)
+        {
+            m_done.notify_one();
+        }
+    }
+}
@@ -5,6 +5,7 @@
 #endif
 
 #include "Texture.hpp"
+#include "Log.hpp"
 
 #include <stdio.h>
 #include <string.h>
@@ -13,6 +14,15 @@
 #include <iostream>
 #include <glad/glad.h>
 #include <memory>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+
+// BC1 is not part of core OpenGL so glad does not define it, but every
+// desktop driver has EXT_texture_compression_s3tc
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
 
 // From Professor Shah's example code
 
@@ -25,7 +35,13 @@ Texture::Texture()
 Texture::~Texture()
 {
     // Delete our texture from the GPU
+    releaseUploadBuffers();
+    releaseLayers();
     glDeleteTextures(1, &m_textureID);
+    if (m_paletteID != 0)
+    {
+        glDeleteTextures(1, &m_paletteID);
+    }
 
     // Delete our image
     if (m_image != nullptr)
@@ -34,8 +50,81 @@ Texture::~Texture()
     }
 }
 
-void Texture::LoadTexture(const std::string filepath)
+// S3TC is an extension, RGTC is core since OpenGL 3.0
+static bool supportsS3TC()
 {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; ++i)
+    {
+        const char *name = reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, i));
+        if (name != nullptr && strcmp(name, "GL_EXT_texture_compression_s3tc") == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Texture::LoadTexture(const std::string filepath, const AnimationOptions &options)
+{
+    // Loading again replaces the texture, drop everything of the old one
+    if (m_textureID != 0)
+    {
+        glDeleteTextures(1, &m_textureID);
+        m_textureID = 0;
+    }
+    if (m_paletteID != 0)
+    {
+        glDeleteTextures(1, &m_paletteID);
+        m_paletteID = 0;
+    }
+    releaseUploadBuffers();
+    releaseLayers();
+    m_frameBuilder.Stop();
+    m_queuedFrame = -1;
+    delete m_image;
+    m_image = nullptr;
+    m_uploadedFrame = -1;
+    m_uploadBufferCount = options.upload_buffers;
+    m_layerBudget = options.resident_layers;
+    if (m_layerBudget > 0 && options.format == PixelFormat::INDEXED)
+    {
+        LOG_WARN("Array textures of frames are RGB only, " << filepath << " is uploaded frame by frame");
+        m_layerBudget = 0;
+    }
+    else if (m_layerBudget == 1)
+    {
+        // a ring needs the frame on screen and the one after it
+        m_layerBudget = 2;
+    }
+    m_frameFormat.mipmaps = options.mipmaps;
+    m_frameFormat.gamma_correct = options.gamma_correct_mips;
+    m_frameFormat.compression = options.compression;
+    if (m_frameFormat.mipmaps && options.format == PixelFormat::INDEXED)
+    {
+        LOG_WARN("Indexed textures cannot be mipmapped, " << filepath << " only has its base level");
+        m_frameFormat.mipmaps = false;
+    }
+    if (m_frameFormat.compression != TextureCompression::NONE)
+    {
+        if (options.format == PixelFormat::INDEXED)
+        {
+            LOG_WARN("Indexed textures are not compressed, " << filepath << " keeps its indices");
+            m_frameFormat.compression = TextureCompression::NONE;
+        }
+        else if (m_frameFormat.compression == TextureCompression::BC1 && !supportsS3TC())
+        {
+            LOG_WARN("The driver has no S3TC support, " << filepath << " is not compressed");
+            m_frameFormat.compression = TextureCompression::NONE;
+        }
+        else if (m_uploadBufferCount > 0)
+        {
+            // compressed frames are small, and are uploaded whole anyway
+            LOG_WARN("Compressed textures skip upload buffers, " << filepath << " is uploaded from memory");
+            m_uploadBufferCount = 0;
+        }
+    }
     // Set member variable
     m_filepath = filepath;
     // Load our actual image data
@@ -47,55 +136,629 @@ void Texture::LoadTexture(const std::string filepath)
     }
     else if (filepath.substr(filepath.find_last_of(".") + 1) == "gif")
     {
-        m_image->LoadGIF(true);
+        if (options.frame_cache_bytes > 0)
+        {
+            m_image->SetLazyDecoding(options.frame_cache_bytes);
+        }
+        // Layers are filled ahead of time anyway, and from frames out of
+        // order, which decode ahead cannot provide
+        if (options.decode_ahead > 0 && m_layerBudget == 0)
+        {
+            m_image->SetDecodeAhead(options.decode_ahead);
+        }
+        m_image->SetClock(options.clock);
+        if (options.delta_keyframes > 0)
+        {
+            m_image->SetDeltaStorage(options.delta_keyframes);
+        }
+        if (!options.cache_file.empty())
+        {
+            m_image->SetCacheFile(options.cache_file);
+        }
+        m_image->LoadGIF(true, options.format);
     }
     else
     {
-        std::cout << "Unsupported file type" << std::endl;
+        LOG_ERROR("Unsupported file type");
         return;
     }
+    if (m_frameFormat.compression != TextureCompression::NONE && m_image->GetFrameCount() == 1)
+    {
+        // glGenerateMipmap cannot fill compressed levels, a still image
+        // gets its chain from the CPU instead
+        m_frameFormat.mipmaps = true;
+    }
 
     Refresh();
 }
+// Copies region of an RGB image width pixels wide into dest as packed RGBA
+// rows, 4 byte pixels are what drivers upload without converting
+static void packRGBA(const uint8_t *rgb, int width, const Rect &region, uint8_t *dest)
+{
+    for (int y = 0; y < region.height; ++y)
+    {
+        const uint8_t *source = rgb + (static_cast<size_t>(region.y + y) * width + region.x) * 3;
+        for (int x = 0; x < region.width; ++x)
+        {
+            dest[0] = source[0];
+            dest[1] = source[1];
+            dest[2] = source[2];
+            dest[3] = 255;
+            source += 3;
+            dest += 4;
+        }
+    }
+}
+
+void Texture::upload(const uint8_t *pixels, const Rect &region)
+{
+    if (IsIndexed())
+    {
+        // Let OpenGL pick the region out of the full frame in place, rows
+        // of indices are not padded to 4 bytes
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, m_image->GetWidth());
+        glPixelStorei(GL_UNPACK_SKIP_PIXELS, region.x);
+        glPixelStorei(GL_UNPACK_SKIP_ROWS, region.y);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, region.x, region.y, region.width, region.height, GL_RED,
+                        GL_UNSIGNED_BYTE, pixels);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+        glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+        return;
+    }
+    // The staging buffer grows to one full frame and is reused after that
+    m_staging.resize(static_cast<size_t>(region.width) * region.height * 4);
+    packRGBA(pixels, m_image->GetWidth(), region, m_staging.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, region.x, region.y, region.width, region.height, GL_RGBA, GL_UNSIGNED_BYTE,
+                    m_staging.data());
+}
+
 void Texture::Refresh()
 {
     if (m_image == nullptr)
     {
-        std::cerr << "No image data to refresh" << std::endl;
+        LOG_ERROR("No image data to refresh");
         return;
     }
-    glEnable(GL_TEXTURE_2D);
-    // Generate a buffer for our texture
-    glGenTextures(1, &m_textureID);
-    // Similar to our vertex buffers, we now 'select'
-    // a texture we want to bind to.
-    // Note the type of data is 'GL_TEXTURE_2D'
-    glBindTexture(GL_TEXTURE_2D, m_textureID);
-    // Now we are going to setup some information about
-    // our textures.
-    // There are four parameters that must be set.
-    // GL_TEXTURE_MIN_FILTER - How texture filters (linearly, etc.)
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    // Wrap mode describes what to do if we go outside the boundaries of
-    // texture.
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    // At this point, we are now ready to load and send some data to OpenGL.
-    glTexImage2D(GL_TEXTURE_2D,
-                 0,
-                 GL_RGB,
-                 m_image->GetWidth(),
-                 m_image->GetHeight(),
-                 0,
-                 GL_RGB,
-                 GL_UNSIGNED_BYTE,
-                 m_image->GetPixelDataPtr()); // Here is the raw pixel data
-    // We are done with our texture data so we can unbind.
-    // Generate a mipmap
-    glGenerateMipmap(GL_TEXTURE_2D);
+    if (m_layerBudget > 0 && m_image->GetFrameCount() > 1)
+    {
+        refreshLayers();
+        return;
+    }
+    // This also advances animated images to the frame that should show now
+    uint8_t *pixels = m_image->GetPixelDataPtr();
+    int frame = m_image->GetFrameIndex();
+    bool indexed = IsIndexed();
+    bool animated = m_image->GetFrameCount() > 1;
+    bool mipmapped = m_frameFormat.mipmaps;
+    bool compressed = m_frameFormat.compression != TextureCompression::NONE;
+    Rect full{0, 0, m_image->GetWidth(), m_image->GetHeight()};
+
+    if (m_textureID == 0)
+    {
+        glEnable(GL_TEXTURE_2D);
+        // Generate a buffer for our texture
+        glGenTextures(1, &m_textureID);
+        // Similar to our vertex buffers, we now 'select'
+        // a texture we want to bind to.
+        // Note the type of data is 'GL_TEXTURE_2D'
+        glBindTexture(GL_TEXTURE_2D, m_textureID);
+        // Now we are going to setup some information about
+        // our textures.
+        // There are four parameters that must be set.
+        // GL_TEXTURE_MIN_FILTER - How texture filters (linearly, etc.)
+        // Indices must not be filtered or mipmapped, the shader filters
+        // after the palette lookup
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                        indexed ? GL_NEAREST : (mipmapped ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR));
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, indexed ? GL_NEAREST : GL_LINEAR);
+        // Wrap mode describes what to do if we go outside the boundaries of
+        // texture.
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        // Animated textures only ever have their base level unless they
+        // are mipmapped, so it is all the storage they need
+        if (animated && !mipmapped)
+        {
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+        }
+        // The storage is allocated once here, every frame after is copied
+        // into it. RGB images are kept as RGBA so rows are 4 byte aligned.
+        // Compressed storage is allocated with the first frame's blocks.
+        if (compressed)
+        {
+            uploadPrepared(frame, pixels, true);
+        }
+        else
+        {
+            glTexImage2D(GL_TEXTURE_2D,
+                         0,
+                         indexed ? GL_R8 : GL_RGBA8,
+                         full.width,
+                         full.height,
+                         0,
+                         indexed ? GL_RED : GL_RGBA,
+                         GL_UNSIGNED_BYTE,
+                         nullptr);
+            upload(pixels, full);
+            if (mipmapped)
+            {
+                uploadPrepared(frame, pixels, true);
+            }
+        }
+        if (mipmapped || compressed)
+        {
+            if (animated)
+            {
+                m_frameBuilder.Start(full.width, full.height, m_frameFormat);
+            }
+            else
+            {
+                // still images never need either again
+                std::vector<uint8_t>().swap(m_staging);
+                m_preparedFrame = PreparedFrame();
+            }
+        }
+        else if (!indexed && !animated)
+        {
+            // Generate a mipmap once, still images never change again
+            glGenerateMipmap(GL_TEXTURE_2D);
+            std::vector<uint8_t>().swap(m_staging);
+        }
+        if (animated && m_uploadBufferCount > 0)
+        {
+            // Every buffer can hold a whole frame
+            size_t frame_bytes = static_cast<size_t>(full.width) * full.height * (indexed ? 1 : 4);
+            m_uploadBuffers.resize(m_uploadBufferCount);
+            for (UploadBuffer &buffer : m_uploadBuffers)
+            {
+                glGenBuffers(1, &buffer.buffer);
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.buffer);
+                glBufferData(GL_PIXEL_UNPACK_BUFFER, frame_bytes, nullptr, GL_STREAM_DRAW);
+            }
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+    }
+    else if (frame == m_uploadedFrame)
+    {
+        // Still showing the frame that is already on the GPU, a frame that
+        // could not be staged before may be now
+        stageNextFrame();
+        queueNextFrame();
+        return;
+    }
+    else if (m_image->GetFrameContentId(frame) == m_image->GetFrameContentId(m_uploadedFrame))
+    {
+        // A repeat of the frame on the GPU, pixels and palette alike
+        m_uploadedFrame = frame;
+        m_skippedUploads++;
+        stageNextFrame();
+        queueNextFrame();
+        return;
+    }
+    else
+    {
+        glBindTexture(GL_TEXTURE_2D, m_textureID);
+        if (compressed)
+        {
+            // blocks are compressed from the whole frame, so all of it is
+            // replaced
+            uploadPrepared(frame, pixels, false);
+        }
+        else if (!uploadStaged(frame))
+        {
+            // The next frame of an animation only differs from the one on
+            // the GPU inside its dirty rectangle, anything else is a full
+            // upload
+            Rect region = full;
+            if (frame == m_uploadedFrame + 1)
+            {
+                region = m_image->GetDirtyRect();
+            }
+            if (region.width > 0 && region.height > 0)
+            {
+                upload(pixels, region);
+            }
+        }
+        if (mipmapped && !compressed)
+        {
+            uploadPrepared(frame, pixels, false);
+        }
+    }
+    m_uploadedFrame = frame;
+
+    if (indexed)
+    {
+        // The palette is a 256x1 RGB texture, it can change every frame
+        // when a GIF uses local color tables
+        if (m_paletteID == 0)
+        {
+            glGenTextures(1, &m_paletteID);
+            glBindTexture(GL_TEXTURE_2D, m_paletteID);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, 256, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+        }
+        glBindTexture(GL_TEXTURE_2D, m_paletteID);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 256, 1, GL_RGB, GL_UNSIGNED_BYTE, m_image->GetPaletteDataPtr());
+    }
     // We are done with our texture data so we can unbind.
     glBindTexture(GL_TEXTURE_2D, 0);
+    // The pixels of this frame are used by now, so the next one can be
+    // fetched into the memory they were in
+    stageNextFrame();
+    queueNextFrame();
+}
+
+void Texture::uploadPrepared(int frame, const uint8_t *pixels, bool allocate)
+{
+    int width = m_image->GetWidth();
+    int height = m_image->GetHeight();
+    const PreparedFrame *prepared = m_frameBuilder.Take(frame);
+    if (prepared == nullptr)
+    {
+        m_staging.resize(static_cast<size_t>(width) * height * 4);
+        packRGBA(pixels, width, Rect{0, 0, width, height}, m_staging.data());
+        PrepareFrame(m_staging.data(), width, height, m_frameFormat, m_preparedFrame);
+        prepared = &m_preparedFrame;
+    }
+    const std::vector<MipLevel> &mips = prepared->mips.levels;
+    if (m_frameFormat.compression != TextureCompression::NONE)
+    {
+        GLenum format = m_frameFormat.compression == TextureCompression::BC1 ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+                                                                              : GL_COMPRESSED_RG_RGTC2;
+        const std::vector<size_t> &offsets = prepared->compressed_offsets;
+        for (size_t i = 0; i < offsets.size(); ++i)
+        {
+            int level_width = i == 0 ? width : mips[i - 1].width;
+            int level_height = i == 0 ? height : mips[i - 1].height;
+            size_t end = i + 1 < offsets.size() ? offsets[i + 1] : prepared->compressed.size();
+            GLsizei bytes = static_cast<GLsizei>(end - offsets[i]);
+            const uint8_t *blocks = prepared->compressed.data() + offsets[i];
+            // A sub image of a compressed texture must be whole blocks or
+            // the whole level, which it always is here
+            if (allocate)
+            {
+                glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(i), format, level_width, level_height, 0,
+                                       bytes, blocks);
+            }
+            else
+            {
+                glCompressedTexSubImage2D(GL_TEXTURE_2D, static_cast<GLint>(i), 0, 0, level_width, level_height,
+                                          format, bytes, blocks);
+            }
+        }
+        return;
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    for (size_t i = 0; i < mips.size(); ++i)
+    {
+        const MipLevel &level = mips[i];
+        const uint8_t *level_pixels = prepared->mips.pixels.data() + level.offset;
+        if (allocate)
+        {
+            glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(i + 1), GL_RGBA8, level.width, level.height, 0, GL_RGBA,
+                         GL_UNSIGNED_BYTE, level_pixels);
+        }
+        else
+        {
+            glTexSubImage2D(GL_TEXTURE_2D, static_cast<GLint>(i + 1), 0, 0, level.width, level.height, GL_RGBA,
+                            GL_UNSIGNED_BYTE, level_pixels);
+        }
+    }
+}
+
+void Texture::queueNextFrame()
+{
+    if (!m_frameBuilder.IsRunning())
+    {
+        return;
+    }
+    int next = (m_uploadedFrame + 1) % static_cast<int>(m_image->GetFrameCount());
+    if (next == m_queuedFrame)
+    {
+        return;
+    }
+    uint8_t *input = m_frameBuilder.Input();
+    if (input == nullptr)
+    {
+        // still busy with a frame that was skipped over
+        return;
+    }
+    Rect dirty;
+    const uint8_t *pixels = m_image->PeekFrame(next, dirty);
+    if (pixels == nullptr)
+    {
+        // decode ahead has not got there yet
+        return;
+    }
+    int width = m_image->GetWidth();
+    int height = m_image->GetHeight();
+    packRGBA(pixels, width, Rect{0, 0, width, height}, input);
+    m_frameBuilder.Submit(next);
+    m_queuedFrame = next;
+}
+
+void Texture::stageNextFrame()
+{
+    if (m_uploadBuffers.empty() || m_stagedBuffer >= 0)
+    {
+        return;
+    }
+    UploadBuffer &buffer = m_uploadBuffers[m_nextUploadBuffer];
+    if (buffer.fence != nullptr)
+    {
+        // Never wait for the GPU here, a buffer it is still copying from
+        // is tried again at the next refresh
+        if (glClientWaitSync(buffer.fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+        {
+            return;
+        }
+        glDeleteSync(buffer.fence);
+        buffer.fence = nullptr;
+    }
+    int next = (m_uploadedFrame + 1) % static_cast<int>(m_image->GetFrameCount());
+    Rect dirty;
+    uint8_t *pixels = m_image->PeekFrame(next, dirty);
+    if (pixels == nullptr)
+    {
+        // decode ahead has not got there yet
+        return;
+    }
+    // A dirty rect is relative to the frame before, looping back to the
+    // first frame replaces everything
+    Rect region = dirty;
+    if (next == 0)
+    {
+        region = Rect{0, 0, m_image->GetWidth(), m_image->GetHeight()};
+    }
+    if (region.width > 0 && region.height > 0)
+    {
+        bool indexed = IsIndexed();
+        size_t bytes = static_cast<size_t>(region.width) * region.height * (indexed ? 1 : 4);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.buffer);
+        // The fence said the GPU is done with the buffer, so it can be
+        // written without the driver synchronizing again
+        uint8_t *mapped = static_cast<uint8_t *>(
+            glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes,
+                             GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+        if (mapped == nullptr)
+        {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            return;
+        }
+        if (indexed)
+        {
+            for (int y = 0; y < region.height; ++y)
+            {
+                memcpy(mapped + static_cast<size_t>(y) * region.width,
+                       pixels + static_cast<size_t>(region.y + y) * m_image->GetWidth() + region.x, region.width);
+            }
+        }
+        else
+        {
+            packRGBA(pixels, m_image->GetWidth(), region, mapped);
+        }
+        bool intact = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE;
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        if (!intact)
+        {
+            return;
+        }
+    }
+    m_stagedBuffer = static_cast<int>(m_nextUploadBuffer);
+    m_stagedFrame = next;
+    m_stagedBase = m_uploadedFrame;
+    m_stagedRegion = region;
+    m_nextUploadBuffer = (m_nextUploadBuffer + 1) % m_uploadBuffers.size();
+}
+
+bool Texture::uploadStaged(int frame)
+{
+    if (m_stagedBuffer < 0)
+    {
+        return false;
+    }
+    UploadBuffer &buffer = m_uploadBuffers[m_stagedBuffer];
+    bool usable = m_stagedFrame == frame &&
+                  m_image->GetFrameContentId(m_stagedBase) == m_image->GetFrameContentId(m_uploadedFrame);
+    // a staged frame that was skipped over is dropped
+    m_stagedBuffer = -1;
+    if (!usable)
+    {
+        return false;
+    }
+    if (m_stagedRegion.width > 0 && m_stagedRegion.height > 0)
+    {
+        const Rect &region = m_stagedRegion;
+        bool indexed = IsIndexed();
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.buffer);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, indexed ? 1 : 4);
+        // With a buffer bound the pointer is an offset into it, the copy
+        // runs on the GPU's time rather than blocking here
+        glTexSubImage2D(GL_TEXTURE_2D, 0, region.x, region.y, region.width, region.height, indexed ? GL_RED : GL_RGBA,
+                        GL_UNSIGNED_BYTE, nullptr);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        buffer.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+    return true;
+}
+
+void Texture::releaseUploadBuffers()
+{
+    for (UploadBuffer &buffer : m_uploadBuffers)
+    {
+        if (buffer.fence != nullptr)
+        {
+            glDeleteSync(buffer.fence);
+        }
+        glDeleteBuffers(1, &buffer.buffer);
+    }
+    m_uploadBuffers.clear();
+    m_nextUploadBuffer = 0;
+    m_stagedBuffer = -1;
+}
+
+void Texture::refreshLayers()
+{
+    // This starts playback and moves the image on to the frame that shows
+    // now, so only frames from it on are filled in
+    m_image->GetPixelDataPtr();
+    int frame_count = static_cast<int>(m_image->GetFrameCount());
+    int width = m_image->GetWidth();
+    int height = m_image->GetHeight();
+    Rect full{0, 0, width, height};
+
+    if (m_arrayID == 0)
+    {
+        m_layers = std::min(frame_count, m_layerBudget);
+        m_ring = m_layers < frame_count;
+        m_ringFilledUntil = -1;
+        glGenTextures(1, &m_arrayID);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, m_arrayID);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, 0);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, width, height, m_layers, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                     nullptr);
+
+        // The shader looks the frame up in the end times itself
+        const std::vector<double> &ends = m_image->GetFrameEndTimesMs();
+        std::vector<float> ends_ms(ends.begin(), ends.end());
+        glGenBuffers(1, &m_frameEndsBuffer);
+        glBindBuffer(GL_TEXTURE_BUFFER, m_frameEndsBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, ends_ms.size() * sizeof(float), ends_ms.data(), GL_STATIC_DRAW);
+        glGenTextures(1, &m_frameEndsID);
+        glBindTexture(GL_TEXTURE_BUFFER, m_frameEndsID);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_R32F, m_frameEndsBuffer);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+        if (!m_ring)
+        {
+            // Every frame is uploaded once and never again
+            for (int frame = 0; frame < frame_count; ++frame)
+            {
+                Rect dirty;
+                uint8_t *pixels = m_image->PeekFrame(frame, dirty);
+                m_staging.resize(static_cast<size_t>(width) * height * 4);
+                packRGBA(pixels, width, full, m_staging.data());
+                glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+                glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, frame, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE,
+                                m_staging.data());
+            }
+            std::vector<uint8_t>().swap(m_staging);
+        }
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    }
+    if (!m_ring)
+    {
+        return;
+    }
+
+    // The ring holds the frame on screen and the ones after it. Frame f of
+    // the timeline goes in layer f % layers, the same layer the shader
+    // computes from the time, so frames already there stay put.
+    long long current = m_image->GetTimelineFrame();
+    long long first = std::max(m_ringFilledUntil + 1, current);
+    long long last = current + m_layers - 1;
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_arrayID);
+    for (long long timeline_frame = first; timeline_frame <= last; ++timeline_frame)
+    {
+        Rect dirty;
+        uint8_t *pixels = m_image->PeekFrame(static_cast<int>(timeline_frame % frame_count), dirty);
+        if (pixels == nullptr)
+        {
+            break;
+        }
+        m_staging.resize(static_cast<size_t>(width) * height * 4);
+        packRGBA(pixels, width, full, m_staging.data());
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, static_cast<int>(timeline_frame % m_layers), width, height, 1,
+                        GL_RGBA, GL_UNSIGNED_BYTE, m_staging.data());
+        m_ringFilledUntil = timeline_frame;
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+void Texture::releaseLayers()
+{
+    if (m_arrayID != 0)
+    {
+        glDeleteTextures(1, &m_arrayID);
+        glDeleteTextures(1, &m_frameEndsID);
+        glDeleteBuffers(1, &m_frameEndsBuffer);
+    }
+    m_arrayID = 0;
+    m_frameEndsID = 0;
+    m_frameEndsBuffer = 0;
+    m_layers = 0;
+    m_ring = false;
+}
+
+void Texture::BindFrames(unsigned int slot) const
+{
+    glActiveTexture(GL_TEXTURE0 + slot);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_arrayID);
+}
+
+void Texture::BindFrameEnds(unsigned int slot) const
+{
+    glActiveTexture(GL_TEXTURE0 + slot);
+    glBindTexture(GL_TEXTURE_BUFFER, m_frameEndsID);
+}
+
+float Texture::GetAnimationTimeMs() const
+{
+    if (m_arrayID == 0)
+    {
+        return 0.0f;
+    }
+    // A ring needs the number of loops played modulo its layer count to
+    // find the layer, a fully resident animation only the time in the loop
+    double loop_ms = m_image->GetFrameEndTimesMs().back();
+    double period_ms = loop_ms * (m_ring ? m_layers : 1);
+    return static_cast<float>(std::fmod(m_image->GetPlaybackTimeMs(), period_ms));
+}
+
+double Texture::GetLoopDurationMs() const
+{
+    if (m_image == nullptr || m_image->GetFrameCount() < 2)
+    {
+        return 0.0;
+    }
+    return m_image->GetFrameEndTimesMs().back();
+}
+
+std::vector<float> Texture::GetAnimationPhasesMs() const
+{
+    if (m_arrayID == 0 || m_ring)
+    {
+        return std::vector<float>(m_phasesMs.size(), 0.0f);
+    }
+    return m_phasesMs;
+}
+
+double Texture::GetNextRefreshTimeMs()
+{
+    if (m_arrayID != 0 && !m_ring)
+    {
+        // the GPU plays a fully resident animation by itself
+        return std::numeric_limits<double>::infinity();
+    }
+    if (m_image == nullptr)
+    {
+        return std::numeric_limits<double>::infinity();
+    }
+    return m_image->GetNextFrameTimeMs();
 }
 
 // slot tells us which slot we want to bind to.
@@ -113,6 +776,12 @@ void Texture::Bind(unsigned int slot) const
     glBindTexture(GL_TEXTURE_2D, m_textureID);
 }
 
+void Texture::BindPalette(unsigned int slot) const
+{
+    glActiveTexture(GL_TEXTURE0 + slot);
+    glBindTexture(GL_TEXTURE_2D, m_paletteID);
+}
+
 void Texture::Unbind()
 {
     glBindTexture(GL_TEXTURE_2D, 0);
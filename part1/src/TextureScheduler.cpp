@@ -0,0 +1,69 @@
+#include "TextureScheduler.hpp"
+#include "Texture.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+TextureScheduler::TextureScheduler(const Clock &clock) : m_clock(clock)
+{
+}
+
+bool TextureScheduler::later(const Entry &a, const Entry &b)
+{
+    return a.deadline_ms > b.deadline_ms;
+}
+
+void TextureScheduler::Add(Texture *texture)
+{
+    double deadline = texture->GetNextRefreshTimeMs();
+    if (std::isinf(deadline))
+    {
+        // a still image, nothing to schedule
+        return;
+    }
+    m_heap.push_back(Entry{deadline, texture});
+    std::push_heap(m_heap.begin(), m_heap.end(), later);
+}
+
+void TextureScheduler::Remove(Texture *texture)
+{
+    auto removed = std::remove_if(m_heap.begin(), m_heap.end(),
+                                  [texture](const Entry &entry) { return entry.texture == texture; });
+    if (removed != m_heap.end())
+    {
+        m_heap.erase(removed, m_heap.end());
+        std::make_heap(m_heap.begin(), m_heap.end(), later);
+    }
+}
+
+size_t TextureScheduler::Update()
+{
+    double now = m_clock.GetTimeMs();
+    // Take every due texture off the heap first, a texture that is still
+    // due after its refresh (decode ahead running late) waits for the next
+    // Update instead of being refreshed again right away
+    m_due.clear();
+    while (!m_heap.empty() && m_heap.front().deadline_ms <= now)
+    {
+        std::pop_heap(m_heap.begin(), m_heap.end(), later);
+        m_due.push_back(m_heap.back().texture);
+        m_heap.pop_back();
+    }
+    for (Texture *texture : m_due)
+    {
+        texture->Refresh();
+        double deadline = texture->GetNextRefreshTimeMs();
+        if (!std::isinf(deadline))
+        {
+            m_heap.push_back(Entry{deadline, texture});
+            std::push_heap(m_heap.begin(), m_heap.end(), later);
+        }
+    }
+    return m_due.size();
+}
+
+double TextureScheduler::GetNextDeadlineMs() const
+{
+    return m_heap.empty() ? std::numeric_limits<double>::infinity() : m_heap.front().deadline_ms;
+}
@@ -16,12 +16,15 @@
 #include <vector>
 #include <string>
 #include <fstream>
+#include <algorithm>
 
 // Our libraries
 #include <Camera.hpp>
 #include <OBJModel.hpp>
 #include <Light.hpp>
 #include <Texture.hpp>
+#include <Log.hpp>
+#include <TextureScheduler.hpp>
 
 // vvvvvvvvvvvvvvvvvvvvvvvvvv Globals vvvvvvvvvvvvvvvvvvvvvvvvvv
 // Globals generally are prefixed with 'g' in this application.
@@ -48,6 +51,35 @@ std::string gTextureFilename = "";
 std::string gNormalMapFilename = "";
 
 std::vector<std::string> gObjectFilenames;
+// Keep animated GIF textures as 8-bit indices on the GPU (--indexed)
+bool gIndexedTextures = false;
+// Decode animated GIF frames as they are shown, caching at most this many
+// MB of decoded frames (--frame-cache-mb N). 0 decodes everything on load.
+size_t gFrameCacheMB = 0;
+// Decode this many GIF frames ahead on a worker thread (--decode-ahead N)
+size_t gDecodeAhead = 0;
+// Keep decoded GIF frames in a .animcache file next to the GIF (--anim-cache)
+bool gAnimCache = false;
+// Store GIF frames as changes against the frame before, keeping every Nth
+// frame in full (--delta-keyframes N). 0 keeps every frame in full.
+int gDeltaKeyframes = 0;
+// Stream GIF frames to the GPU through this many pixel buffer objects
+// (--upload-buffers N). 0 uploads them straight from memory.
+int gUploadBuffers = 0;
+// Keep up to this many GIF frames in the layers of an array texture and
+// let the shader pick the frame (--resident-layers N). 0 uploads frames
+// one at a time as they come due.
+int gResidentLayers = 0;
+// Draw this many copies of the object side by side (--instances N). With a
+// layered animation each one plays it from its own point in the loop.
+int gInstances = 1;
+// Give textures a mip chain built on the CPU (--mipmaps), averaged in
+// linear light with --gamma-correct-mipmaps
+bool gMipmaps = false;
+bool gGammaCorrectMipmaps = false;
+// Keep the diffuse texture as BC1 and the normal map as RGTC2 on the GPU
+// (--compress-textures)
+bool gCompressTextures = false;
 
 // OpenGL Objects
 // Vertex Array Object (VAO)
@@ -64,6 +96,9 @@ GLuint gVertexBufferObject = 0;
 // This is used to store the array of indices that we want
 // to draw from, when we do indexed drawing.
 GLuint gIndexBufferObject = 0;
+// Per instance data, the animation phase of each instance
+GLuint gInstanceBufferObject = 0;
+GLsizei gInstanceCount = 1;
 
 // A second object for drawing a normal
 GLuint gVertexArrayObjectForNormal = 0;
@@ -90,6 +125,11 @@ Texture gTexture;
 // Normal Map
 Texture gNormalMap;
 
+// Animated textures play by this clock and are refreshed by the scheduler
+// when their frames are due
+SteadyClock gAnimationClock;
+TextureScheduler gTextureScheduler(gAnimationClock);
+
 // Draw wireframe mode
 GLenum gPolygonMode = GL_FILL;
 
@@ -343,8 +383,34 @@ float avgOfThree(float a, float b, float c)
 void VertexSpecification()
 {
 	// load texture
-	gTexture.LoadTexture(gTextureFilename);
-	gNormalMap.LoadTexture(gNormalMapFilename);
+	AnimationOptions options;
+	options.format = gIndexedTextures ? PixelFormat::INDEXED : PixelFormat::RGB;
+	options.frame_cache_bytes = gFrameCacheMB * 1024 * 1024;
+	options.decode_ahead = gDecodeAhead;
+	options.delta_keyframes = gDeltaKeyframes;
+	options.upload_buffers = gUploadBuffers;
+	options.resident_layers = gResidentLayers;
+	options.mipmaps = gMipmaps;
+	options.gamma_correct_mips = gGammaCorrectMipmaps;
+	options.compression = gCompressTextures ? TextureCompression::BC1 : TextureCompression::NONE;
+	options.clock = &gAnimationClock;
+	if (gAnimCache)
+	{
+		options.cache_file = gTextureFilename + ".animcache";
+	}
+	gTexture.LoadTexture(gTextureFilename, options);
+	// instances start their loops evenly spread over it
+	std::vector<float> phasesMs;
+	double loopMs = gTexture.GetLoopDurationMs();
+	for (int i = 0; i < gInstances; ++i)
+	{
+		phasesMs.push_back(static_cast<float>(loopMs * i / gInstances));
+	}
+	gTexture.SetAnimationPhasesMs(phasesMs);
+	gTextureScheduler.Add(&gTexture);
+	AnimationOptions normalMapOptions;
+	normalMapOptions.compression = gCompressTextures ? TextureCompression::RGTC2 : TextureCompression::NONE;
+	gNormalMap.LoadTexture(gNormalMapFilename, normalMapOptions);
 
 	// Vertex Arrays Object (VAO) Setup
 	// Note: We can think of the VAO as a 'wrapper around' all of the Vertex Buffer Objects,
@@ -449,6 +515,47 @@ void VertexSpecification()
 						  sizeof(GL_FLOAT) * numberOfFloatsPerVertex,
 						  (void *)(sizeof(GL_FLOAT) * 14));
 
+	// animation phase and position offset, from a buffer of their own that
+	// moves on once per instance rather than once per vertex
+	float minX = 0.0f;
+	float maxX = 0.0f;
+	for (size_t v = 0; v < gVertexData.size(); v += numberOfFloatsPerVertex)
+	{
+		minX = v == 0 ? gVertexData[v] : std::min(minX, gVertexData[v]);
+		maxX = v == 0 ? gVertexData[v] : std::max(maxX, gVertexData[v]);
+	}
+	// instances stand in a row centered on the origin, a little apart
+	float spacing = (maxX - minX) * 1.25f;
+	std::vector<float> instanceData;
+	std::vector<float> instancePhasesMs = gTexture.GetAnimationPhasesMs();
+	gInstanceCount = static_cast<GLsizei>(instancePhasesMs.size());
+	for (GLsizei i = 0; i < gInstanceCount; ++i)
+	{
+		instanceData.push_back(instancePhasesMs[i]);
+		instanceData.push_back(spacing * (i - (gInstanceCount - 1) / 2.0f));
+		instanceData.push_back(0.0f);
+		instanceData.push_back(0.0f);
+	}
+	glGenBuffers(1, &gInstanceBufferObject);
+	glBindBuffer(GL_ARRAY_BUFFER, gInstanceBufferObject);
+	glBufferData(GL_ARRAY_BUFFER, instanceData.size() * sizeof(GL_FLOAT), instanceData.data(), GL_STATIC_DRAW);
+	glEnableVertexAttribArray(6);
+	glVertexAttribPointer(6,
+						  1,
+						  GL_FLOAT,
+						  GL_FALSE,
+						  sizeof(GL_FLOAT) * 4,
+						  (void *)0);
+	glVertexAttribDivisor(6, 1);
+	glEnableVertexAttribArray(7);
+	glVertexAttribPointer(7,
+						  3,
+						  GL_FLOAT,
+						  GL_FALSE,
+						  sizeof(GL_FLOAT) * 4,
+						  (void *)(sizeof(GL_FLOAT) * 1));
+	glVertexAttribDivisor(7, 1);
+
 	// Unbind our currently bound Vertex Array Object
 	glBindVertexArray(0);
 	// Disable any attributes we opened in our Vertex Attribute Arrray,
@@ -459,6 +566,7 @@ void VertexSpecification()
 	glDisableVertexAttribArray(3);
 	glDisableVertexAttribArray(4);
 	glDisableVertexAttribArray(5);
+	glDisableVertexAttribArray(6);
 }
 
 /**
@@ -647,6 +755,47 @@ void PreDraw()
 		exit(EXIT_FAILURE);
 	}
 
+	// Indexed textures are expanded through their palette in the shader
+	GLint u_indexedLocation = glGetUniformLocation(gGraphicsPipelineShaderProgram, "u_DiffuseIndexed");
+	GLint u_paletteLocation = glGetUniformLocation(gGraphicsPipelineShaderProgram, "u_DiffusePalette");
+	if (u_indexedLocation >= 0 && u_paletteLocation >= 0)
+	{
+		gTexture.BindPalette(2);
+		glUniform1i(u_paletteLocation, 2);
+		glUniform1i(u_indexedLocation, gTexture.IsIndexed());
+	}
+	else
+	{
+		std::cout << "Could not find u_DiffuseIndexed or u_DiffusePalette, maybe a misspelling?" << std::endl;
+		exit(EXIT_FAILURE);
+	}
+
+	// Animations kept in an array texture pick their frame on the GPU from
+	// the time, nothing is uploaded for them per frame
+	GLint u_layeredLocation = glGetUniformLocation(gGraphicsPipelineShaderProgram, "u_DiffuseLayered");
+	GLint u_framesLocation = glGetUniformLocation(gGraphicsPipelineShaderProgram, "u_DiffuseFrames");
+	GLint u_frameEndsLocation = glGetUniformLocation(gGraphicsPipelineShaderProgram, "u_FrameEnds");
+	GLint u_frameCountLocation = glGetUniformLocation(gGraphicsPipelineShaderProgram, "u_FrameCount");
+	GLint u_ringLayersLocation = glGetUniformLocation(gGraphicsPipelineShaderProgram, "u_RingLayers");
+	GLint u_animationTimeLocation = glGetUniformLocation(gGraphicsPipelineShaderProgram, "u_AnimationTimeMs");
+	if (u_layeredLocation >= 0 && u_framesLocation >= 0 && u_frameEndsLocation >= 0 && u_frameCountLocation >= 0 &&
+		u_ringLayersLocation >= 0 && u_animationTimeLocation >= 0)
+	{
+		gTexture.BindFrames(3);
+		gTexture.BindFrameEnds(4);
+		glUniform1i(u_framesLocation, 3);
+		glUniform1i(u_frameEndsLocation, 4);
+		glUniform1i(u_layeredLocation, gTexture.IsLayered());
+		glUniform1i(u_frameCountLocation, gTexture.GetFrameCount());
+		glUniform1i(u_ringLayersLocation, gTexture.GetRingLayers());
+		glUniform1f(u_animationTimeLocation, gTexture.GetAnimationTimeMs());
+	}
+	else
+	{
+		std::cout << "Could not find the layered animation uniforms, maybe a misspelling?" << std::endl;
+		exit(EXIT_FAILURE);
+	}
+
 	gNormalMap.Bind(1);
 
 	// Setup our uniform for our normal map
@@ -661,6 +810,18 @@ void PreDraw()
 		std::cout << "Could not find u_BumpMap, maybe a misspelling?" << std::endl;
 		exit(EXIT_FAILURE);
 	}
+
+	// Compressed normal maps only keep x and y
+	GLint u_twoChannelLocation = glGetUniformLocation(gGraphicsPipelineShaderProgram, "u_BumpMapTwoChannel");
+	if (u_twoChannelLocation >= 0)
+	{
+		glUniform1i(u_twoChannelLocation, gNormalMap.IsTwoChannel());
+	}
+	else
+	{
+		std::cout << "Could not find u_BumpMapTwoChannel, maybe a misspelling?" << std::endl;
+		exit(EXIT_FAILURE);
+	}
 }
 
 /**
@@ -676,10 +837,11 @@ void Draw()
 
 	// Render OBJ
 	glBindVertexArray(gVertexArrayObject);
-	glDrawElements(GL_TRIANGLES,
-				   gIndexBufferData.size(),
-				   GL_UNSIGNED_INT,
-				   0);
+	glDrawElementsInstanced(GL_TRIANGLES,
+							gIndexBufferData.size(),
+							GL_UNSIGNED_INT,
+							0,
+							gInstanceCount);
 
 	// render lights
 	for (Light &light : gLights)
@@ -870,7 +1032,6 @@ void UpdateLightPositions()
  */
 void MainLoop()
 {
-	Uint32 last_time = SDL_GetTicks();
 	// Little trick to map mouse to center of screen always.
 	// Useful for handling 'mouselook'
 	// This works because we effectively 're-center' our mouse at the start
@@ -898,11 +1059,12 @@ void MainLoop()
 		// Update screen of our specified window
 		SDL_GL_SwapWindow(gGraphicsApplicationWindow);
 
-		if (SDL_GetTicks() - last_time >= 50)
-		{
-			gTexture.Refresh();
-			last_time = SDL_GetTicks();
-		}
+		// Upload new frames of the animated textures whose current frame
+		// is over, the rest are left alone
+		gTextureScheduler.Update();
+		// Write out what was logged this frame, logging itself never
+		// touches the terminal
+		Log::Flush();
 	}
 }
 
@@ -921,6 +1083,7 @@ void CleanUp()
 
 	// Delete our OpenGL Objects
 	glDeleteBuffers(1, &gVertexBufferObject);
+	glDeleteBuffers(1, &gInstanceBufferObject);
 	glDeleteVertexArrays(1, &gVertexArrayObject);
 
 	// Delete our Graphics pipeline
@@ -940,6 +1103,72 @@ int main(int argc, char *args[])
 
 	for (int i = 1; i < argc; i++)
 	{
+		if (std::string(args[i]) == "--indexed")
+		{
+			gIndexedTextures = true;
+			continue;
+		}
+		if (std::string(args[i]) == "--frame-cache-mb" && i + 1 < argc)
+		{
+			gFrameCacheMB = std::stoul(args[++i]);
+			continue;
+		}
+		if (std::string(args[i]) == "--anim-cache")
+		{
+			gAnimCache = true;
+			continue;
+		}
+		if (std::string(args[i]) == "--decode-ahead" && i + 1 < argc)
+		{
+			gDecodeAhead = std::stoul(args[++i]);
+			continue;
+		}
+		if (std::string(args[i]) == "--log-level" && i + 1 < argc)
+		{
+			std::string level = args[++i];
+			Log::SetLevel(level == "trace"   ? LogLevel::TRACE
+						  : level == "debug" ? LogLevel::DEBUG
+						  : level == "warn"  ? LogLevel::WARN
+						  : level == "error" ? LogLevel::ERROR
+											 : LogLevel::INFO);
+			continue;
+		}
+		if (std::string(args[i]) == "--resident-layers" && i + 1 < argc)
+		{
+			gResidentLayers = std::stoi(args[++i]);
+			continue;
+		}
+		if (std::string(args[i]) == "--upload-buffers" && i + 1 < argc)
+		{
+			gUploadBuffers = std::stoi(args[++i]);
+			continue;
+		}
+		if (std::string(args[i]) == "--compress-textures")
+		{
+			gCompressTextures = true;
+			continue;
+		}
+		if (std::string(args[i]) == "--mipmaps")
+		{
+			gMipmaps = true;
+			continue;
+		}
+		if (std::string(args[i]) == "--gamma-correct-mipmaps")
+		{
+			gMipmaps = true;
+			gGammaCorrectMipmaps = true;
+			continue;
+		}
+		if (std::string(args[i]) == "--instances" && i + 1 < argc)
+		{
+			gInstances = std::max(1, std::stoi(args[++i]));
+			continue;
+		}
+		if (std::string(args[i]) == "--delta-keyframes" && i + 1 < argc)
+		{
+			gDeltaKeyframes = std::stoi(args[++i]);
+			continue;
+		}
 		gObjectFilenames.push_back(args[i]);
 	}
 
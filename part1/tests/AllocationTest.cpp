@@ -0,0 +1,88 @@
+#include "Test.hpp"
+#include "TestGif.hpp"
+#include "AllocationCounter.hpp"
+#include "FrameWriter.hpp"
+#include "Image.hpp"
+#include "LZWDecoder.hpp"
+
+#include <memory>
+
+// Decodes one frame's image data, as EncodeTestImageData lays it out
+static void decodeFrame(LZWDecoder &decoder, const std::vector<uint8_t> &data, FrameWriter &writer)
+{
+    decoder.Begin(data[0]);
+    const uint8_t *block = data.data() + 1;
+    const uint8_t *end = data.data() + data.size();
+    while (block < end && *block != 0 && !decoder.Finished())
+    {
+        decoder.Decode(block + 1, *block, writer);
+        block += 1 + *block;
+    }
+}
+
+// Once the decoder and the frame buffers are set up, decoding a frame must
+// not touch the heap. The decode loop runs for every frame an animation
+// shows.
+TEST(decode_does_not_allocate_per_frame)
+{
+    const int frame_count = 12;
+    std::vector<Frame> frames(frame_count);
+    std::vector<std::vector<uint8_t>> indices(frame_count);
+    std::vector<std::vector<uint8_t>> image_data(frame_count);
+    for (int f = 0; f < frame_count; ++f)
+    {
+        // frames of different sizes, like the frames of an animation
+        Frame &frame = frames[f];
+        frame.width = 20 + f * 3;
+        frame.height = 10 + f * 2;
+        frame.interlaced = false;
+        for (int c = 0; c < 256; ++c)
+        {
+            frame.color_table.push_back(Color(c, c, c));
+        }
+        frame.data.resize(static_cast<size_t>(frame.width) * frame.height * 3);
+        for (int y = 0; y < frame.height; ++y)
+        {
+            for (int x = 0; x < frame.width; ++x)
+            {
+                indices[f].push_back(static_cast<uint8_t>((x / 3 + y / 2 + f) % 16));
+            }
+        }
+        image_data[f] = EncodeTestImageData(indices[f]);
+    }
+    std::unique_ptr<LZWDecoder> decoder(new LZWDecoder());
+
+    for (PixelFormat format : {PixelFormat::RGB, PixelFormat::INDEXED})
+    {
+        for (int pass = 0; pass < 2; ++pass)
+        {
+            // the first pass warms up whatever is set up lazily
+            size_t before = AllocationCount();
+            for (int f = 0; f < frame_count; ++f)
+            {
+                Frame &frame = frames[f];
+                size_t pixels = static_cast<size_t>(frame.width) * frame.height;
+                // each frame is its own canvas
+                FrameWriter writer(frame.data.data(), frame.width, frame.height, frame, false, format);
+                decodeFrame(*decoder, image_data[f], writer);
+                CHECK(writer.GetPixelsWritten() == pixels);
+            }
+            if (pass > 0)
+            {
+                CHECK(AllocationCount() == before);
+            }
+        }
+
+        // with a grey ramp for a table every channel holds the color index
+        size_t stride = format == PixelFormat::INDEXED ? 1 : 3;
+        size_t mismatches = 0;
+        for (int f = 0; f < frame_count; ++f)
+        {
+            for (size_t p = 0; p < indices[f].size(); ++p)
+            {
+                mismatches += frames[f].data[p * stride] != indices[f][p];
+            }
+        }
+        CHECK(mismatches == 0);
+    }
+}
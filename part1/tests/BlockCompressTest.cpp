@@ -0,0 +1,234 @@
+#include "Test.hpp"
+#include "TestBlockDecode.hpp"
+#include "BlockCompress.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+// Sizes with edge blocks that reach past the image on either side or both
+static const int SIZES[][2]{{1, 1}, {3, 2}, {4, 4}, {5, 7}, {13, 9}, {16, 16}, {33, 17}};
+
+static std::string sizeName(int width, int height)
+{
+    return std::to_string(width) + "x" + std::to_string(height);
+}
+
+// A smooth image between two colors, the kind of content BC1 is meant
+// for: every pixel lies on the line from one to the other, further along
+// to the right and down
+static std::vector<uint8_t> gradientRGBA(int width, int height, const uint8_t from[3], const uint8_t to[3])
+{
+    std::vector<uint8_t> rgba;
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            int along = x + 2 * y;
+            int length = std::max(1, width - 1 + 2 * (height - 1));
+            for (int c = 0; c < 3; ++c)
+            {
+                rgba.push_back(static_cast<uint8_t>(from[c] + (to[c] - from[c]) * along / length));
+            }
+            rgba.push_back(255);
+        }
+    }
+    return rgba;
+}
+
+static std::vector<uint8_t> compress(TextureCompression compression, const std::vector<uint8_t> &rgba, int width,
+                                     int height)
+{
+    std::vector<uint8_t> blocks(CompressedSize(compression, width, height));
+    CompressImage(compression, rgba.data(), width, height, blocks.data());
+    return blocks;
+}
+
+// On a gradient BC1 keeps every channel within half a step of the four
+// between the block's ends plus what 565 loses, and never writes the
+// three color mode
+TEST(bc1_round_trip_error)
+{
+    const uint8_t ends[][2][3]{
+        {{0, 0, 0}, {255, 255, 255}}, {{250, 30, 10}, {20, 90, 240}}, {{60, 200, 90}, {70, 40, 100}}};
+    for (const auto &size : SIZES)
+    {
+        int width = size[0];
+        int height = size[1];
+        CHECK(CompressedSize(TextureCompression::BC1, width, height) ==
+              static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * 8);
+        for (const auto &end : ends)
+        {
+            std::vector<uint8_t> rgba = gradientRGBA(width, height, end[0], end[1]);
+            std::vector<uint8_t> blocks = compress(TextureCompression::BC1, rgba, width, height);
+            for (size_t b = 0; b < blocks.size(); b += 8)
+            {
+                int color0 = blocks[b] | (blocks[b + 1] << 8);
+                int color1 = blocks[b + 2] | (blocks[b + 3] << 8);
+                CHECK(color0 >= color1);
+            }
+            std::vector<uint8_t> decoded = DecodeBC1(blocks.data(), width, height);
+            for (int y = 0; y < height; ++y)
+            {
+                for (int x = 0; x < width; ++x)
+                {
+                    // the range of each channel over the pixel's block
+                    int low[3]{255, 255, 255};
+                    int high[3]{0, 0, 0};
+                    for (int by = y / 4 * 4; by < std::min(y / 4 * 4 + 4, height); ++by)
+                    {
+                        for (int bx = x / 4 * 4; bx < std::min(x / 4 * 4 + 4, width); ++bx)
+                        {
+                            for (int c = 0; c < 3; ++c)
+                            {
+                                low[c] = std::min<int>(low[c], rgba[(static_cast<size_t>(by) * width + bx) * 4 + c]);
+                                high[c] = std::max<int>(high[c], rgba[(static_cast<size_t>(by) * width + bx) * 4 + c]);
+                            }
+                        }
+                    }
+                    size_t pixel = (static_cast<size_t>(y) * width + x) * 4;
+                    for (int c = 0; c < 3; ++c)
+                    {
+                        int error = std::abs(decoded[pixel + c] - rgba[pixel + c]);
+                        // 565 is off by up to 4 at each end
+                        if (error * 6 > high[c] - low[c] + 6 * 8)
+                        {
+                            TestFail(__FILE__, __LINE__,
+                                     "BC1 " + sizeName(width, height) + " error " + std::to_string(error) +
+                                         " in a range of " + std::to_string(high[c] - low[c]));
+                        }
+                    }
+                    CHECK(decoded[pixel + 3] == 255);
+                }
+            }
+        }
+    }
+}
+
+// Every RGTC2 value is within half a step of the eight between its block's
+// smallest and largest value, for any content
+TEST(rgtc2_round_trip_error)
+{
+    std::mt19937 random(9);
+    for (const auto &size : SIZES)
+    {
+        int width = size[0];
+        int height = size[1];
+        CHECK(CompressedSize(TextureCompression::RGTC2, width, height) ==
+              static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * 16);
+        std::vector<uint8_t> rgba(static_cast<size_t>(width) * height * 4);
+        for (uint8_t &byte : rgba)
+        {
+            byte = static_cast<uint8_t>(random());
+        }
+        std::vector<uint8_t> blocks = compress(TextureCompression::RGTC2, rgba, width, height);
+        std::vector<uint8_t> decoded = DecodeRGTC2(blocks.data(), width, height);
+        int blocks_wide = (width + 3) / 4;
+        for (int y = 0; y < height; ++y)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                size_t pixel = (static_cast<size_t>(y) * width + x) * 4;
+                const uint8_t *block = blocks.data() + ((y / 4) * blocks_wide + x / 4) * 16;
+                for (int c = 0; c < 2; ++c)
+                {
+                    // the first value is the block's largest
+                    int range = block[c * 8] - block[c * 8 + 1];
+                    CHECK(range >= 0);
+                    int error = std::abs(decoded[pixel + c] - rgba[pixel + c]);
+                    if (error * 14 > range + 14)
+                    {
+                        TestFail(__FILE__, __LINE__,
+                                 "RGTC2 " + sizeName(width, height) + " error " + std::to_string(error) +
+                                     " in a range of " + std::to_string(range));
+                    }
+                }
+                CHECK(decoded[pixel + 2] == 0 && decoded[pixel + 3] == 255);
+            }
+        }
+    }
+}
+
+// A block of one color stores it as both endpoints, BC1 as the nearest 565
+// color and RGTC2 exactly
+TEST(block_compress_flat_blocks)
+{
+    const uint8_t colors[][3]{{0, 0, 0}, {255, 255, 255}, {37, 140, 251}, {128, 1, 64}};
+    for (const auto &color : colors)
+    {
+        std::vector<uint8_t> rgba;
+        for (int i = 0; i < 6 * 5; ++i)
+        {
+            rgba.insert(rgba.end(), {color[0], color[1], color[2], 255});
+        }
+        std::vector<uint8_t> bc1 = compress(TextureCompression::BC1, rgba, 6, 5);
+        for (size_t b = 0; b < bc1.size(); b += 8)
+        {
+            // color0 == color1 and every index 0
+            CHECK(bc1[b] == bc1[b + 2] && bc1[b + 1] == bc1[b + 3]);
+            CHECK(bc1[b + 4] == 0 && bc1[b + 5] == 0 && bc1[b + 6] == 0 && bc1[b + 7] == 0);
+        }
+        std::vector<uint8_t> decoded = DecodeBC1(bc1.data(), 6, 5);
+        for (size_t i = 0; i < rgba.size(); i += 4)
+        {
+            // 5 bits of red and blue, 6 of green
+            CHECK(std::abs(decoded[i] - rgba[i]) <= 4);
+            CHECK(std::abs(decoded[i + 1] - rgba[i + 1]) <= 2);
+            CHECK(std::abs(decoded[i + 2] - rgba[i + 2]) <= 4);
+            CHECK(decoded[i + 3] == 255);
+        }
+
+        std::vector<uint8_t> rgtc2 = compress(TextureCompression::RGTC2, rgba, 6, 5);
+        decoded = DecodeRGTC2(rgtc2.data(), 6, 5);
+        for (size_t i = 0; i < rgba.size(); i += 4)
+        {
+            CHECK(decoded[i] == rgba[i] && decoded[i + 1] == rgba[i + 1]);
+        }
+    }
+}
+
+// Edge blocks repeat the last row and column rather than mixing in
+// anything from outside the image, so a last row and column of their own
+// color come back as that color alone
+TEST(block_compress_edge_blocks)
+{
+    const uint8_t inside[3]{20, 200, 60};
+    const uint8_t edge[3]{240, 16, 180};
+    for (const auto &size : SIZES)
+    {
+        // with a width or height of 1 mod 4 the edge blocks hold only the
+        // last column or row
+        int width = size[0] - size[0] % 4 + 1;
+        int height = size[1] - size[1] % 4 + 1;
+        std::vector<uint8_t> rgba;
+        for (int y = 0; y < height; ++y)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                const uint8_t *color = x == width - 1 || y == height - 1 ? edge : inside;
+                rgba.insert(rgba.end(), {color[0], color[1], color[2], 255});
+            }
+        }
+        std::vector<uint8_t> bc1 = DecodeBC1(compress(TextureCompression::BC1, rgba, width, height).data(), width,
+                                             height);
+        std::vector<uint8_t> rgtc2 =
+            DecodeRGTC2(compress(TextureCompression::RGTC2, rgba, width, height).data(), width, height);
+        for (int y = 0; y < height; ++y)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                size_t pixel = (static_cast<size_t>(y) * width + x) * 4;
+                bool exact = rgtc2[pixel] == rgba[pixel] && rgtc2[pixel + 1] == rgba[pixel + 1];
+                bool close = std::abs(bc1[pixel] - rgba[pixel]) <= 4 && std::abs(bc1[pixel + 1] - rgba[pixel + 1]) <= 2 &&
+                             std::abs(bc1[pixel + 2] - rgba[pixel + 2]) <= 4;
+                if (!exact || !close)
+                {
+                    TestFail(__FILE__, __LINE__,
+                             "pixel " + std::to_string(x) + "," + std::to_string(y) + " of " +
+                                 sizeName(width, height) + (exact ? " BC1" : " RGTC2"));
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,107 @@
+#include "Test.hpp"
+#include "TestGif.hpp"
+#include "FrameCache.hpp"
+#include "Image.hpp"
+
+#include <cstring>
+
+// size bytes of frame index's pixels, every byte the index
+static std::vector<uint8_t> framePixels(int index, size_t size)
+{
+    return std::vector<uint8_t>(size, static_cast<uint8_t>(index));
+}
+
+// Whether the cache holds frame index with the pixels framePixels gives.
+// Counts as a Find.
+static bool holds(FrameCache &cache, int index, size_t size)
+{
+    const uint8_t *pixels = cache.Find(index);
+    return pixels != nullptr && memcmp(pixels, framePixels(index, size).data(), size) == 0;
+}
+
+// Frames are evicted least recently used first, Find counting as a use,
+// and the cache never holds more than its budget unless a single frame is
+// larger than it
+TEST(frame_cache_evicts_least_recently_used)
+{
+    const size_t size = 100;
+    FrameCache cache;
+    cache.SetBudget(3 * size);
+    CHECK(cache.GetBudget() == 3 * size);
+    for (int i = 0; i < 3; ++i)
+    {
+        cache.Insert(i, framePixels(i, size).data(), size);
+    }
+    CHECK(cache.GetBytes() == 3 * size);
+
+    // 0 is now used more recently than 1, so 1 goes to make room for 3
+    CHECK(holds(cache, 0, size));
+    cache.Insert(3, framePixels(3, size).data(), size);
+    CHECK(cache.GetBytes() == 3 * size);
+    CHECK(!holds(cache, 1, size));
+    CHECK(holds(cache, 2, size));
+    CHECK(holds(cache, 0, size));
+    CHECK(holds(cache, 3, size));
+    CHECK(cache.GetHits() == 4);
+    CHECK(cache.GetMisses() == 1);
+
+    // storing a frame again replaces it and makes it the most recent
+    std::vector<uint8_t> replaced(size, 0xEE);
+    cache.Insert(2, replaced.data(), size);
+    CHECK(cache.GetBytes() == 3 * size);
+    const uint8_t *pixels = cache.Find(2);
+    CHECK(pixels != nullptr && memcmp(pixels, replaced.data(), size) == 0);
+
+    // use order is now 2, 3, 0, so a smaller budget drops 0 then 3
+    cache.SetBudget(2 * size);
+    CHECK(cache.GetBytes() == 2 * size);
+    CHECK(cache.Find(0) == nullptr);
+    cache.SetBudget(size);
+    CHECK(cache.GetBytes() == size);
+    CHECK(cache.Find(3) == nullptr);
+    CHECK(cache.Find(2) != nullptr);
+
+    // a frame larger than the budget is still kept, on its own
+    cache.SetBudget(3 * size);
+    cache.Insert(4, framePixels(4, size).data(), size);
+    cache.Insert(5, framePixels(5, 4 * size).data(), 4 * size);
+    CHECK(cache.GetBytes() == 4 * size);
+    CHECK(holds(cache, 5, 4 * size));
+    CHECK(cache.Find(4) == nullptr);
+    CHECK(cache.Find(2) == nullptr);
+
+    cache.Clear();
+    CHECK(cache.GetBytes() == 0);
+    CHECK(cache.Find(5) == nullptr);
+}
+
+// Playing an animation that decodes on demand finds its frames in the
+// cache on the second loop when the budget holds the whole loop, and never
+// when it holds less, since a loop always wants the oldest frame next
+TEST(frame_cache_counts_playback_hits)
+{
+    const int frame_count = 9;
+    std::string path = MakeTestAnimation("frame_cache_playback", frame_count);
+    for (int budget_frames : {frame_count, 3})
+    {
+        Image image(path);
+        // the canvas is 40 x 30 RGB
+        image.SetLazyDecoding(static_cast<size_t>(budget_frames) * 40 * 30 * 3);
+        image.LoadGIF(false);
+        const FrameCache &cache = image.GetFrameCache();
+        size_t hits = cache.GetHits();
+        size_t misses = cache.GetMisses();
+        for (int loop = 0; loop < 2; ++loop)
+        {
+            for (int i = 0; i < frame_count; ++i)
+            {
+                Rect dirty;
+                image.PeekFrame(i, dirty);
+            }
+        }
+        CHECK(cache.GetBytes() <= cache.GetBudget());
+        bool fits = budget_frames == frame_count;
+        CHECK(cache.GetHits() - hits == (fits ? frame_count : 0u));
+        CHECK(cache.GetMisses() - misses == (fits ? frame_count : 2u * frame_count));
+    }
+}
@@ -0,0 +1,35 @@
+#include "Test.hpp"
+#include "FramePrefetcher.hpp"
+
+#include <chrono>
+#include <thread>
+
+// A frame that fails reaches the consumer with its error, in order, and
+// the worker decodes nothing after it
+TEST(prefetcher_hands_errors_to_consumer)
+{
+    FramePrefetcher prefetcher;
+    prefetcher.Start(5, 0, 2, 4,
+                     [](int index, PrefetchedFrame &out)
+                     {
+                         if (index == 2)
+                         {
+                             out.error = "corrupt frame";
+                             return;
+                         }
+                         out.pixels.assign(out.pixels.size(), static_cast<uint8_t>(index));
+                     });
+    CHECK(prefetcher.Current().error.empty());
+    for (int expected = 1; expected <= 2; ++expected)
+    {
+        while (!prefetcher.Advance())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        CHECK(prefetcher.Current().index == expected);
+    }
+    CHECK(prefetcher.Current().error == "corrupt frame");
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    CHECK(prefetcher.Peek() == nullptr);
+    prefetcher.Stop();
+}
@@ -0,0 +1,174 @@
+#include "Test.hpp"
+#include "FrameWriter.hpp"
+#include "GifCompositor.hpp"
+
+#include <string>
+
+struct CompositorStep
+{
+    Rect rect;
+    // one hex digit per color index, row after row
+    const char *indices;
+    int transparent_index;
+    Disposal disposal;
+    // the canvas once the frame is drawn, rows from the top
+    const char *canvas[4];
+    Rect dirty;
+};
+
+static const int CANVAS_WIDTH = 6;
+static const int CANVAS_HEIGHT = 4;
+static const uint8_t BACKGROUND = 9;
+
+// Every disposal method in turn, each frame drawn over what the one before
+// left behind. Frame 1 has a transparent pixel that keeps the 1 under it.
+static const CompositorStep STEPS[] = {
+    {{0, 0, 6, 4}, "111111111111111111111111", -1, Disposal::NONE,
+     {"111111", "111111", "111111", "111111"}, {0, 0, 6, 4}},
+    {{1, 1, 2, 2}, "2522", 5, Disposal::BACKGROUND,
+     {"111111", "121111", "122111", "111111"}, {1, 1, 2, 2}},
+    // frame 1's whole rect is cleared, its transparent pixel included
+    {{3, 0, 2, 2}, "3333", -1, Disposal::PREVIOUS,
+     {"111331", "199331", "199111", "111111"}, {1, 0, 4, 3}},
+    // frame 2's rect goes back to what was there before it was drawn
+    {{0, 2, 3, 2}, "444444", -1, Disposal::KEEP,
+     {"111111", "199111", "444111", "444111"}, {0, 0, 5, 4}},
+    {{4, 3, 2, 1}, "66", -1, Disposal::NONE,
+     {"111111", "199111", "444111", "444166"}, {4, 3, 2, 1}},
+};
+
+static uint8_t hexDigit(char c)
+{
+    return static_cast<uint8_t>(c <= '9' ? c - '0' : c - 'a' + 10);
+}
+
+static std::vector<Color> testPalette()
+{
+    std::vector<Color> palette;
+    for (int i = 0; i < 16; ++i)
+    {
+        palette.emplace_back(static_cast<uint8_t>(i * 16), static_cast<uint8_t>(255 - i * 16),
+                             static_cast<uint8_t>(i * 5));
+    }
+    return palette;
+}
+
+// What the canvas of step should hold, in the compositor's storage order
+static std::vector<uint8_t> expectedCanvas(const CompositorStep &step, PixelFormat format, bool flip,
+                                           const std::vector<Color> &palette)
+{
+    std::vector<uint8_t> canvas;
+    for (int i = 0; i < CANVAS_WIDTH * CANVAS_HEIGHT; ++i)
+    {
+        // reversing the pixel order is what flipping does
+        int pixel = flip ? CANVAS_WIDTH * CANVAS_HEIGHT - 1 - i : i;
+        uint8_t index = hexDigit(step.canvas[pixel / CANVAS_WIDTH][pixel % CANVAS_WIDTH]);
+        if (format == PixelFormat::INDEXED)
+        {
+            canvas.push_back(index);
+        }
+        else
+        {
+            canvas.insert(canvas.end(), {palette[index].r, palette[index].g, palette[index].b});
+        }
+    }
+    return canvas;
+}
+
+static bool sameRect(const Rect &a, const Rect &b)
+{
+    return a.x == b.x && a.y == b.y && a.width == b.width && a.height == b.height;
+}
+
+// The canvas after each frame and the region reported as changed follow
+// the disposal of the frame before, in both formats and both storage
+// orders, and again after a restart
+TEST(compositor_applies_every_disposal)
+{
+    std::vector<Color> palette = testPalette();
+    for (PixelFormat format : {PixelFormat::RGB, PixelFormat::INDEXED})
+    {
+        for (bool flip : {false, true})
+        {
+            GifCompositor compositor;
+            compositor.Reset(CANVAS_WIDTH, CANVAS_HEIGHT, format, flip, BACKGROUND, palette);
+            for (int pass = 0; pass < 2; ++pass)
+            {
+                for (size_t s = 0; s < sizeof(STEPS) / sizeof(STEPS[0]); ++s)
+                {
+                    const CompositorStep &step = STEPS[s];
+                    Frame frame;
+                    frame.left = step.rect.x;
+                    frame.top = step.rect.y;
+                    frame.width = step.rect.width;
+                    frame.height = step.rect.height;
+                    frame.interlaced = false;
+                    frame.color_table = palette;
+                    frame.transparent_index = step.transparent_index;
+                    frame.disposal = step.disposal;
+                    std::vector<uint8_t> indices;
+                    for (const char *c = step.indices; *c; ++c)
+                    {
+                        indices.push_back(hexDigit(*c));
+                    }
+
+                    compositor.BeginFrame(frame);
+                    FrameWriter writer(compositor.GetCanvas(), CANVAS_WIDTH, CANVAS_HEIGHT, frame, flip, format);
+                    writer.Write(indices.data(), indices.size());
+                    compositor.EndFrame(frame);
+
+                    std::string where = "frame " + std::to_string(s) + (flip ? " flipped" : "") +
+                                        (format == PixelFormat::INDEXED ? " indexed" : " rgb") +
+                                        (pass > 0 ? " after a restart" : "");
+                    std::vector<uint8_t> expected = expectedCanvas(step, format, flip, palette);
+                    std::vector<uint8_t> canvas(compositor.GetCanvas(),
+                                                compositor.GetCanvas() + compositor.GetCanvasSize());
+                    if (canvas != expected)
+                    {
+                        TestFail(__FILE__, __LINE__, "wrong canvas after " + where);
+                    }
+                    Rect dirty = step.dirty;
+                    if (flip)
+                    {
+                        dirty.x = CANVAS_WIDTH - dirty.x - dirty.width;
+                        dirty.y = CANVAS_HEIGHT - dirty.y - dirty.height;
+                    }
+                    if (!sameRect(frame.dirty, dirty))
+                    {
+                        TestFail(__FILE__, __LINE__, "wrong dirty rect after " + where);
+                    }
+                }
+                compositor.Restart();
+            }
+        }
+    }
+}
+
+// The background fills the canvas before the first frame, and the first
+// frame reports the whole canvas as changed even if it covers less of it
+TEST(compositor_starts_from_the_background)
+{
+    std::vector<Color> palette = testPalette();
+    GifCompositor compositor;
+    compositor.Reset(CANVAS_WIDTH, CANVAS_HEIGHT, PixelFormat::RGB, false, BACKGROUND, palette);
+    CHECK(compositor.GetCanvasSize() == static_cast<size_t>(CANVAS_WIDTH) * CANVAS_HEIGHT * 3);
+    Frame frame;
+    frame.left = 2;
+    frame.top = 1;
+    frame.width = 1;
+    frame.height = 1;
+    frame.interlaced = false;
+    frame.color_table = palette;
+    compositor.BeginFrame(frame);
+    const uint8_t index = 4;
+    FrameWriter writer(compositor.GetCanvas(), CANVAS_WIDTH, CANVAS_HEIGHT, frame, false);
+    writer.Write(&index, 1);
+    compositor.EndFrame(frame);
+    CHECK(sameRect(frame.dirty, Rect{0, 0, CANVAS_WIDTH, CANVAS_HEIGHT}));
+    const uint8_t *canvas = compositor.GetCanvas();
+    for (int i = 0; i < CANVAS_WIDTH * CANVAS_HEIGHT; ++i)
+    {
+        const Color &color = palette[i == CANVAS_WIDTH + 2 ? index : BACKGROUND];
+        CHECK(canvas[i * 3] == color.r && canvas[i * 3 + 1] == color.g && canvas[i * 3 + 2] == color.b);
+    }
+}
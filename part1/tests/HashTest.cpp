@@ -0,0 +1,27 @@
+#include "Test.hpp"
+#include "Hash.hpp"
+
+#include <vector>
+
+// Flipping the top bit of two words in the same lane must not cancel out
+TEST(hash_sees_top_bit_changes)
+{
+    std::vector<uint8_t> data(128, 0x5A);
+    uint64_t before = HashBytes(data.data(), data.size());
+    data[7] ^= 0x80;
+    data[7 + 32] ^= 0x80;
+    CHECK(HashBytes(data.data(), data.size()) != before);
+}
+
+// Every single bit of the input changes the hash
+TEST(hash_sees_every_bit)
+{
+    std::vector<uint8_t> data(100, 0);
+    uint64_t zero = HashBytes(data.data(), data.size());
+    for (size_t bit = 0; bit < data.size() * 8; ++bit)
+    {
+        data[bit / 8] ^= static_cast<uint8_t>(1u << (bit % 8));
+        CHECK(HashBytes(data.data(), data.size()) != zero);
+        data[bit / 8] ^= static_cast<uint8_t>(1u << (bit % 8));
+    }
+}
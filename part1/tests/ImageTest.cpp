@@ -0,0 +1,447 @@
+#include "Test.hpp"
+#include "TestGif.hpp"
+#include "GifIndex.hpp"
+#include "Image.hpp"
+#include "Log.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <random>
+
+// Every frame of image back to back, in its pixel format
+static std::vector<uint8_t> allFrames(Image &image)
+{
+    std::vector<uint8_t> frames;
+    for (size_t i = 0; i < image.GetFrameCount(); ++i)
+    {
+        Rect dirty;
+        const uint8_t *pixels = image.PeekFrame(static_cast<int>(i), dirty);
+        int bytes_per_pixel = image.GetPixelFormat() == PixelFormat::INDEXED ? 1 : 3;
+        size_t size = static_cast<size_t>(image.GetWidth()) * image.GetHeight() * bytes_per_pixel;
+        frames.insert(frames.end(), pixels, pixels + size);
+    }
+    return frames;
+}
+
+static std::vector<uint8_t> loadFrames(const std::string &path, const std::function<void(Image &)> &configure,
+                                       PixelFormat format = PixelFormat::RGB, bool flip = false)
+{
+    Image image(path);
+    configure(image);
+    image.LoadGIF(flip, format);
+    return allFrames(image);
+}
+
+// Decoding up front in batches of any size gives the frames decoding each
+// one on demand does
+TEST(image_batched_decode_matches_lazy)
+{
+    for (std::string path : {std::string(TEST_MEDIA("chapel/sample.gif")), MakeTestAnimation("batched_decode", 23)})
+    {
+        std::vector<uint8_t> lazy = loadFrames(path, [](Image &image) { image.SetLazyDecoding(0); });
+        CHECK(!lazy.empty());
+        for (unsigned threads : {1u, 3u, 64u})
+        {
+            std::vector<uint8_t> eager =
+                loadFrames(path, [threads](Image &image) { image.SetDecodeThreads(threads); });
+            CHECK(eager == lazy);
+        }
+    }
+}
+
+// A cache file that cannot be written leaves every frame decoded in
+// memory, even for an image that was asked to decode on demand
+TEST(image_cache_write_failure_keeps_frames)
+{
+    std::string path = MakeTestAnimation("cache_write_failure", 6);
+    std::vector<uint8_t> expected = loadFrames(path, [](Image &) {});
+    for (bool decode_ahead : {false, true})
+    {
+        // the failed write is expected, not worth reporting
+        Log::SetLevel(LogLevel::OFF);
+        std::vector<uint8_t> frames = loadFrames(
+            path, [decode_ahead](Image &image)
+            {
+                image.SetCacheFile("/nonexistent/directory/sample.animcache");
+                image.SetLazyDecoding(0);
+                if (decode_ahead)
+                {
+                    image.SetDecodeAhead(2);
+                }
+            });
+        Log::SetLevel(LogLevel::WARN);
+        CHECK(frames == expected);
+    }
+}
+
+// Plays image to frame index on clock, which started at the image's first
+// frame, and returns the pixels shown
+static const uint8_t *showFrame(Image &image, ManualClock &clock, int index)
+{
+    const std::vector<double> &ends = image.GetFrameEndTimesMs();
+    double target = index == 0 ? 0.0 : ends[index - 1];
+    clock.Advance(target - clock.GetTimeMs());
+    return image.GetPixelDataPtr();
+}
+
+// The indexed canvas looked up in each frame's palette is what the RGB
+// decode draws, for every way frames are stored. The shader does that
+// lookup, so this checks the upload side of the indexed path without a GL
+// context. An animation with local color tables cannot share one canvas
+// of indices and is decoded as RGB instead.
+TEST(image_indexed_frames_expand_to_rgb)
+{
+    for (bool local_tables : {false, true})
+    {
+        std::string path = MakeTestAnimation(local_tables ? "indexed_local_tables" : "indexed_frames", 17, local_tables);
+        std::string cache = path + ".animcache";
+        std::vector<std::function<void(Image &)>> modes{
+            [](Image &) {},
+            [](Image &image) { image.SetLazyDecoding(0); },
+            [](Image &image) { image.SetDeltaStorage(4); },
+            [&cache](Image &image) { image.SetCacheFile(cache); },
+        };
+        for (size_t mode = 0; mode < modes.size(); ++mode)
+        {
+            ManualClock rgb_clock;
+            ManualClock indexed_clock;
+            Image rgb(path);
+            Image indexed(path);
+            modes[mode](rgb);
+            modes[mode](indexed);
+            rgb.SetClock(&rgb_clock);
+            indexed.SetClock(&indexed_clock);
+            // each image gets a cache file of its own
+            remove(cache.c_str());
+            rgb.LoadGIF(true, PixelFormat::RGB);
+            remove(cache.c_str());
+            // the fallback to RGB is expected, not worth reporting
+            Log::SetLevel(LogLevel::ERROR);
+            indexed.LoadGIF(true, PixelFormat::INDEXED);
+            Log::SetLevel(LogLevel::WARN);
+            CHECK(indexed.GetPixelFormat() == (local_tables ? PixelFormat::RGB : PixelFormat::INDEXED));
+            CHECK(indexed.GetFrameCount() == rgb.GetFrameCount());
+
+            size_t pixels = static_cast<size_t>(rgb.GetWidth()) * rgb.GetHeight();
+            for (int i = 0; i < static_cast<int>(rgb.GetFrameCount()); ++i)
+            {
+                const uint8_t *expected = showFrame(rgb, rgb_clock, i);
+                const uint8_t *shown = showFrame(indexed, indexed_clock, i);
+                CHECK(indexed.GetFrameIndex() == i);
+                std::vector<uint8_t> expanded(shown, shown + pixels * 3);
+                if (indexed.GetPixelFormat() == PixelFormat::INDEXED)
+                {
+                    const uint8_t *palette = indexed.GetPaletteDataPtr();
+                    for (size_t p = 0; p < pixels; ++p)
+                    {
+                        memcpy(&expanded[p * 3], palette + shown[p] * 3, 3);
+                    }
+                }
+                if (memcmp(expanded.data(), expected, expanded.size()) != 0)
+                {
+                    TestFail(__FILE__, __LINE__,
+                             "frame " + std::to_string(i) + " differs in storage mode " + std::to_string(mode));
+                }
+            }
+        }
+        // an indexed load finds the RGB cache the fallback wrote
+        Image cached(path);
+        cached.SetCacheFile(cache);
+        Log::SetLevel(LogLevel::ERROR);
+        cached.LoadGIF(true, PixelFormat::INDEXED);
+        Log::SetLevel(LogLevel::WARN);
+        CHECK(cached.GetPixelFormat() == (local_tables ? PixelFormat::RGB : PixelFormat::INDEXED));
+        CHECK(cached.GetFrameCount() == 17);
+        remove(cache.c_str());
+    }
+}
+
+// Each frame is drawn with its own local color table, while the pixels it
+// leaves alone keep the colors of the frames before it
+TEST(image_local_color_tables)
+{
+    std::vector<Color> global{Color(0, 0, 0), Color(10, 20, 30)};
+    std::vector<Color> local{Color(0, 0, 0), Color(200, 100, 50), Color(1, 2, 3)};
+    std::vector<TestGifFrame> frames(2);
+    frames[0].rect = Rect{0, 0, 4, 2};
+    frames[0].indices.assign(8, 1);
+    // a 2x1 frame whose second pixel is transparent
+    frames[1].rect = Rect{1, 1, 2, 1};
+    frames[1].indices = {1, 2};
+    frames[1].transparent_index = 2;
+    frames[1].local_palette = local;
+    std::string path = (std::filesystem::temp_directory_path() / "local_color_tables.gif").string();
+    CHECK(WriteTestGif(path, 4, 2, global, frames));
+
+    for (PixelFormat format : {PixelFormat::RGB, PixelFormat::INDEXED})
+    {
+        Log::SetLevel(LogLevel::ERROR);
+        std::vector<uint8_t> pixels = loadFrames(path, [](Image &) {}, format);
+        Log::SetLevel(LogLevel::WARN);
+        CHECK(pixels.size() == 2 * 8 * 3);
+        if (pixels.size() != 2 * 8 * 3)
+        {
+            continue;
+        }
+        const uint8_t *second = pixels.data() + 8 * 3;
+        // (1, 1) from the local table, (2, 1) transparent
+        CHECK(second[5 * 3] == 200 && second[5 * 3 + 1] == 100 && second[5 * 3 + 2] == 50);
+        CHECK(second[6 * 3] == 10 && second[6 * 3 + 1] == 20 && second[6 * 3 + 2] == 30);
+        CHECK(second[0] == 10 && second[1] == 20 && second[2] == 30);
+    }
+}
+
+// Probe reports the delays playback uses, a frame without one showing for
+// 100 ms
+TEST(image_probe_delays_match_playback)
+{
+    std::vector<TestGifFrame> frames(3);
+    int delays_cs[]{0, 7, 30};
+    for (size_t i = 0; i < frames.size(); ++i)
+    {
+        frames[i].rect = Rect{0, 0, 2, 2};
+        frames[i].indices.assign(4, static_cast<uint8_t>(i));
+        frames[i].delay_cs = delays_cs[i];
+    }
+    std::string path = (std::filesystem::temp_directory_path() / "probe_delays.gif").string();
+    CHECK(WriteTestGif(path, 2, 2, {Color(0, 0, 0), Color(1, 1, 1), Color(2, 2, 2)}, frames));
+
+    GifIndex index;
+    CHECK(Image::Probe(path, index));
+    CHECK(index.GetFrameCount() == 3);
+    if (index.GetFrameCount() != 3)
+    {
+        return;
+    }
+    CHECK(index.frames[0].delay_ms == 100);
+    CHECK(index.frames[1].delay_ms == 70);
+    CHECK(index.frames[2].delay_ms == 300);
+    CHECK(index.total_duration_ms == 470);
+
+    Image image(path);
+    image.LoadGIF(false);
+    const std::vector<double> &ends = image.GetFrameEndTimesMs();
+    CHECK(ends.size() == 3 && ends[0] == 100.0 && ends[1] == 170.0 && ends[2] == 470.0);
+}
+
+// A file that does not start with a GIF signature is not a GIF
+TEST(image_probe_rejects_bad_signature)
+{
+    std::string path = (std::filesystem::temp_directory_path() / "bad_signature.gif").string();
+    std::vector<TestGifFrame> frames(1);
+    frames[0].rect = Rect{0, 0, 2, 2};
+    frames[0].indices.assign(4, 1);
+    CHECK(WriteTestGif(path, 2, 2, {Color(0, 0, 0), Color(1, 1, 1)}, frames));
+    GifIndex index;
+    CHECK(Image::Probe(path, index));
+
+    // the same file with its version mangled
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(3);
+    file.write("88a", 3);
+    file.close();
+    Log::SetLevel(LogLevel::OFF);
+    CHECK(!Image::Probe(path, index));
+    Log::SetLevel(LogLevel::WARN);
+}
+
+// Interlaced frames end up with their rows where a plain encode of the same
+// frames puts them, for frames of every height around the pass steps,
+// flipped or not, decoded up front or on demand
+TEST(image_interlaced_rows_match_plain)
+{
+    std::vector<std::pair<std::string, std::string>> pairs{
+        {MakeTestAnimation("plain_rows", 12), MakeTestAnimation("interlaced_rows", 12, false, true)}};
+    std::vector<Color> palette;
+    for (int i = 0; i < 16; ++i)
+    {
+        palette.push_back(Color(i * 16, i * 8, 255 - i * 16));
+    }
+    for (int height = 1; height <= 10; ++height)
+    {
+        // one color per row, so rows out of place show
+        std::vector<TestGifFrame> frames(1);
+        frames[0].rect = Rect{0, 0, 3, height};
+        for (int y = 0; y < height; ++y)
+        {
+            frames[0].indices.insert(frames[0].indices.end(), 3, static_cast<uint8_t>(y));
+        }
+        std::string name = "rows_" + std::to_string(height);
+        std::string plain = (std::filesystem::temp_directory_path() / ("plain_" + name + ".gif")).string();
+        std::string interlaced = (std::filesystem::temp_directory_path() / ("interlaced_" + name + ".gif")).string();
+        CHECK(WriteTestGif(plain, 3, height, palette, frames));
+        frames[0].interlaced = true;
+        CHECK(WriteTestGif(interlaced, 3, height, palette, frames));
+        pairs.emplace_back(plain, interlaced);
+    }
+
+    for (const auto &pair : pairs)
+    {
+        GifIndex index;
+        CHECK(Image::Probe(pair.second, index));
+        CHECK(index.GetFrameCount() > 0 && index.frames[0].interlaced);
+        for (bool flip : {false, true})
+        {
+            std::vector<uint8_t> expected = loadFrames(pair.first, [](Image &) {}, PixelFormat::RGB, flip);
+            CHECK(!expected.empty());
+            for (bool lazy : {false, true})
+            {
+                auto configure = [lazy](Image &image)
+                {
+                    if (lazy)
+                    {
+                        image.SetLazyDecoding(0);
+                    }
+                };
+                if (loadFrames(pair.second, configure, PixelFormat::RGB, flip) != expected)
+                {
+                    TestFail(__FILE__, __LINE__,
+                             pair.second + (flip ? " flipped" : "") + (lazy ? " on demand" : "") +
+                                 " does not match its plain encode");
+                }
+            }
+        }
+    }
+}
+
+// Frames kept as deltas between keyframes come back as the frames kept in
+// full, whichever order they are asked for in and however far apart the
+// keyframes are, including further apart than there are frames
+TEST(image_delta_frames_match_full_frames)
+{
+    const int frame_count = 17;
+    std::string path = MakeTestAnimation("delta_frames", frame_count);
+    // forwards, backwards across every keyframe, then at random
+    std::vector<int> order;
+    for (int i = 0; i < frame_count; ++i)
+    {
+        order.push_back(i);
+    }
+    for (int i = frame_count - 1; i >= 0; --i)
+    {
+        order.push_back(i);
+    }
+    std::mt19937 random(11);
+    for (int i = 0; i < 3 * frame_count; ++i)
+    {
+        order.push_back(static_cast<int>(random() % frame_count));
+    }
+
+    for (PixelFormat format : {PixelFormat::RGB, PixelFormat::INDEXED})
+    {
+        for (bool flip : {false, true})
+        {
+            Image full(path);
+            full.LoadGIF(flip, format);
+            std::vector<uint8_t> expected = allFrames(full);
+            size_t frame_size = expected.size() / frame_count;
+            for (int keyframe_interval : {1, 2, 3, 5, 16, 17, 40})
+            {
+                Image delta(path);
+                delta.SetDeltaStorage(keyframe_interval);
+                delta.LoadGIF(flip, format);
+                CHECK(delta.GetFrameCount() == static_cast<size_t>(frame_count));
+                CHECK(delta.GetPixelFormat() == format);
+                for (int index : order)
+                {
+                    Rect dirty;
+                    const uint8_t *pixels = delta.PeekFrame(index, dirty);
+                    if (memcmp(pixels, expected.data() + index * frame_size, frame_size) != 0)
+                    {
+                        TestFail(__FILE__, __LINE__,
+                                 "frame " + std::to_string(index) + " with keyframes every " +
+                                     std::to_string(keyframe_interval) +
+                                     (format == PixelFormat::INDEXED ? " indexed" : " rgb") + (flip ? " flipped" : ""));
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Advancing a manual clock past one or several delays at once lands on the
+// frame the time falls in, counting the loops and frames played through
+TEST(image_plays_by_its_clock)
+{
+    // shown for 100, 70 and 300 ms
+    std::vector<TestGifFrame> frames(3);
+    int delays_cs[]{0, 7, 30};
+    for (size_t i = 0; i < frames.size(); ++i)
+    {
+        frames[i].rect = Rect{0, 0, 2, 2};
+        frames[i].indices.assign(4, static_cast<uint8_t>(i));
+        frames[i].delay_cs = delays_cs[i];
+    }
+    std::string path = (std::filesystem::temp_directory_path() / "clock_playback.gif").string();
+    CHECK(WriteTestGif(path, 2, 2, {Color(0, 0, 0), Color(1, 1, 1), Color(2, 2, 2)}, frames));
+
+    struct Step
+    {
+        double elapsed_ms;
+        int frame;
+        long long timeline_frame;
+        double next_frame_ms;
+    };
+    const Step steps[]{
+        {0.0, 0, 0, 100.0},
+        {99.5, 0, 0, 100.0},
+        {100.0, 1, 1, 170.0},
+        {469.0, 2, 2, 470.0},
+        // into the second loop
+        {470.0, 0, 3, 570.0},
+        // past frames 0 and 1 of the second loop at once
+        {645.0, 2, 5, 940.0},
+        // several loops at once
+        {2000.0, 1, 13, 2050.0},
+    };
+    ManualClock clock;
+    // playback starts wherever the clock is at the first frame
+    clock.Advance(1000.0);
+    Image image(path);
+    image.SetClock(&clock);
+    image.LoadGIF(false);
+    CHECK(image.GetPlaybackTimeMs() == 0.0);
+    for (const Step &step : steps)
+    {
+        clock.Advance(1000.0 + step.elapsed_ms - clock.GetTimeMs());
+        const uint8_t *pixels = image.GetPixelDataPtr();
+        std::string at = " at " + std::to_string(step.elapsed_ms) + " ms";
+        if (image.GetFrameIndex() != step.frame || pixels[0] != step.frame)
+        {
+            TestFail(__FILE__, __LINE__, "wrong frame" + at);
+        }
+        if (image.GetTimelineFrame() != step.timeline_frame)
+        {
+            TestFail(__FILE__, __LINE__, "wrong timeline frame" + at);
+        }
+        // loops played before this one
+        CHECK(image.GetTimelineFrame() / 3 == static_cast<long long>(step.elapsed_ms / 470.0));
+        CHECK(image.GetPlaybackTimeMs() == step.elapsed_ms);
+        if (image.GetNextFrameTimeMs() != 1000.0 + step.next_frame_ms)
+        {
+            TestFail(__FILE__, __LINE__, "wrong next frame time" + at);
+        }
+    }
+
+    // a paused playback clock holds the frame, a faster one plays through
+    // the frames sooner
+    ManualClock source;
+    PlaybackClock playback(source);
+    Image paused(path);
+    paused.SetClock(&playback);
+    paused.LoadGIF(false);
+    paused.GetPixelDataPtr();
+    playback.SetPaused(true);
+    source.Advance(250.0);
+    paused.GetPixelDataPtr();
+    CHECK(paused.GetFrameIndex() == 0);
+    playback.SetPaused(false);
+    playback.SetRate(2.0);
+    source.Advance(60.0);
+    paused.GetPixelDataPtr();
+    CHECK(paused.GetFrameIndex() == 1);
+    CHECK(paused.GetPlaybackTimeMs() == 120.0);
+}
@@ -0,0 +1,128 @@
+#include "Test.hpp"
+#include "MipChain.hpp"
+
+#include <cstring>
+#include <random>
+#include <string>
+
+static std::vector<uint8_t> randomRGBA(std::mt19937 &random, int width, int height)
+{
+    std::vector<uint8_t> rgba(static_cast<size_t>(width) * height * 4);
+    for (uint8_t &byte : rgba)
+    {
+        byte = static_cast<uint8_t>(random());
+    }
+    return rgba;
+}
+
+// The dispatched filter writes exactly the bytes of the scalar one, for
+// odd and even sizes around the 4 pixel SSE2 step and sides of 1, with and
+// without gamma correction, and nothing past the level
+TEST(mip_kernel_matches_scalar)
+{
+    std::mt19937 random(7);
+    for (int height = 1; height <= 9; ++height)
+    {
+        for (int width = 1; width <= 21; ++width)
+        {
+            std::vector<uint8_t> rgba = randomRGBA(random, width, height);
+            size_t size = static_cast<size_t>(std::max(1, width / 2)) * std::max(1, height / 2) * 4;
+            for (bool gamma_correct : {false, true})
+            {
+                // a guard byte past the end catches kernels writing too much
+                std::vector<uint8_t> expected(size + 1, 0xAB);
+                std::vector<uint8_t> actual(size + 1, 0xAB);
+                DownsampleRGBAScalar(rgba.data(), width, height, gamma_correct, expected.data());
+                DownsampleRGBA(rgba.data(), width, height, gamma_correct, actual.data());
+                if (actual != expected)
+                {
+                    TestFail(__FILE__, __LINE__,
+                             std::string(MipKernelName()) + " differs from scalar at " + std::to_string(width) + "x" +
+                                 std::to_string(height) + (gamma_correct ? " gamma correct" : ""));
+                }
+            }
+        }
+    }
+}
+
+// Each level is the box filter of the one above, rounded to nearest, with
+// color averaged in linear light when asked and alpha always as is
+TEST(mip_filter_known_values)
+{
+    // black and white side by side over two rows, half transparent
+    const uint8_t rgba[]{0, 0, 0, 0, 255, 255, 255, 255, 0, 0, 0, 0, 255, 255, 255, 255};
+    uint8_t out[4];
+    DownsampleRGBA(rgba, 2, 2, false, out);
+    CHECK(out[0] == 128 && out[1] == 128 && out[2] == 128 && out[3] == 128);
+    // half of full brightness in linear light is 188 in sRGB
+    DownsampleRGBA(rgba, 2, 2, true, out);
+    CHECK(out[0] == 188 && out[1] == 188 && out[2] == 188 && out[3] == 128);
+
+    // an odd last column or row is left out, a side of 1 repeats its pixel
+    const uint8_t row[]{10, 20, 30, 40, 30, 40, 50, 60, 200, 200, 200, 200};
+    DownsampleRGBA(row, 3, 1, false, out);
+    CHECK(out[0] == 20 && out[1] == 30 && out[2] == 40 && out[3] == 50);
+    DownsampleRGBA(row, 1, 3, false, out);
+    CHECK(out[0] == 20 && out[1] == 30 && out[2] == 40 && out[3] == 50);
+}
+
+// BuildMipChain sizes every level down to 1x1 and fills each from the
+// level above it with the scalar filter's bytes, and a flat image stays
+// flat all the way down
+TEST(mip_chain_levels_match_scalar)
+{
+    std::mt19937 random(3);
+    const int sizes[][2]{{13, 7}, {1, 9}, {33, 1}, {64, 16}, {31, 17}};
+    MipChain chain;
+    for (const auto &size : sizes)
+    {
+        int width = size[0];
+        int height = size[1];
+        std::vector<uint8_t> rgba = randomRGBA(random, width, height);
+        for (bool gamma_correct : {false, true})
+        {
+            BuildMipChain(rgba.data(), width, height, gamma_correct, chain);
+            CHECK(static_cast<int>(chain.levels.size()) == MipLevelCount(width, height));
+            if (chain.levels.empty())
+            {
+                continue;
+            }
+            CHECK(chain.levels.back().width == 1 && chain.levels.back().height == 1);
+
+            std::vector<uint8_t> source = rgba;
+            int source_width = width;
+            int source_height = height;
+            for (size_t i = 0; i < chain.levels.size(); ++i)
+            {
+                const MipLevel &level = chain.levels[i];
+                CHECK(level.width == std::max(1, source_width / 2));
+                CHECK(level.height == std::max(1, source_height / 2));
+                std::vector<uint8_t> expected(static_cast<size_t>(level.width) * level.height * 4);
+                DownsampleRGBAScalar(source.data(), source_width, source_height, gamma_correct, expected.data());
+                if (memcmp(chain.pixels.data() + level.offset, expected.data(), expected.size()) != 0)
+                {
+                    TestFail(__FILE__, __LINE__,
+                             "level " + std::to_string(i) + " of " + std::to_string(width) + "x" +
+                                 std::to_string(height) + (gamma_correct ? " gamma correct" : ""));
+                }
+                source = expected;
+                source_width = level.width;
+                source_height = level.height;
+            }
+
+            std::vector<uint8_t> flat(rgba.size());
+            for (size_t i = 0; i < flat.size(); i += 4)
+            {
+                flat[i] = 37;
+                flat[i + 1] = 140;
+                flat[i + 2] = 251;
+                flat[i + 3] = 90;
+            }
+            BuildMipChain(flat.data(), width, height, gamma_correct, chain);
+            for (size_t i = 0; i < chain.pixels.size(); ++i)
+            {
+                CHECK(chain.pixels[i] == flat[i % 4]);
+            }
+        }
+    }
+}
@@ -0,0 +1,66 @@
+#include "Test.hpp"
+#include "PaletteExpand.hpp"
+
+#include <cstring>
+#include <random>
+
+// Every kernel must write exactly the bytes of the scalar reference, for
+// every run length around the vector widths and from unaligned buffers
+TEST(palette_kernels_match_scalar)
+{
+    std::mt19937 random(5);
+    uint32_t palette[256];
+    for (uint32_t &entry : palette)
+    {
+        entry = static_cast<uint32_t>(random());
+    }
+    std::vector<uint8_t> indices(300 + 16);
+    for (uint8_t &index : indices)
+    {
+        index = static_cast<uint8_t>(random());
+    }
+    std::vector<PaletteExpandKernel> kernels = PaletteExpandKernels();
+    CHECK(strcmp(kernels.front().name, "scalar") == 0);
+    CHECK(strcmp(kernels.back().name, PaletteExpandKernelName()) == 0);
+    // a guard byte past the end catches kernels writing too much
+    std::vector<uint8_t> expected((300 + 16) * 4 + 1);
+    std::vector<uint8_t> actual(expected.size());
+    for (const PaletteExpandKernel &kernel : kernels)
+    {
+        for (int bytes_per_pixel : {3, 4})
+        {
+            PaletteExpandFunction reference = bytes_per_pixel == 3 ? ExpandPaletteRGBScalar : ExpandPaletteRGBAScalar;
+            PaletteExpandFunction expand = bytes_per_pixel == 3 ? kernel.rgb : kernel.rgba;
+            for (size_t offset = 0; offset < 8; ++offset)
+            {
+                for (size_t count = 0; count <= 300; ++count)
+                {
+                    memset(expected.data(), 0xAB, expected.size());
+                    memset(actual.data(), 0xAB, actual.size());
+                    reference(indices.data() + offset, count, palette, expected.data() + offset);
+                    expand(indices.data() + offset, count, palette, actual.data() + offset);
+                    if (memcmp(expected.data(), actual.data(), expected.size()) != 0)
+                    {
+                        TestFail(__FILE__, __LINE__,
+                                 std::string(kernel.name) + " differs at " + std::to_string(bytes_per_pixel) +
+                                     " bytes per pixel, count " + std::to_string(count) + ", offset " +
+                                     std::to_string(offset));
+                        return;
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST(palette_packs_color_table)
+{
+    std::vector<Color> table{Color(1, 2, 3), Color(250, 251, 252)};
+    uint32_t palette[256];
+    PackPalette(table, palette);
+    CHECK(palette[0] == 0xFF030201u);
+    CHECK(palette[1] == 0xFFFCFBFAu);
+    // entries past the table are opaque black
+    CHECK(palette[2] == 0xFF000000u);
+    CHECK(palette[255] == 0xFF000000u);
+}
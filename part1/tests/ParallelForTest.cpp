@@ -0,0 +1,46 @@
+#include "Test.hpp"
+#include "ParallelFor.hpp"
+
+#include <stdexcept>
+
+// Every round runs each of its jobs exactly once on the same threads, and
+// a job that throws ends its round without ending the group
+TEST(worker_group_runs_every_job_each_round)
+{
+    WorkerGroup group(4);
+    CHECK(group.GetThreadCount() == 4);
+    for (size_t count : {0u, 1u, 3u, 17u, 200u})
+    {
+        std::vector<std::atomic<int>> runs(count);
+        auto job = [&runs](size_t i) { runs[i]++; };
+        group.Run(count, job);
+        group.Run(count, job);
+        for (size_t i = 0; i < count; ++i)
+        {
+            CHECK(runs[i] == 2);
+        }
+    }
+
+    bool thrown = false;
+    auto failing = [](size_t i)
+    {
+        if (i == 5)
+        {
+            throw std::runtime_error("job 5");
+        }
+    };
+    try
+    {
+        group.Run(64, failing);
+    }
+    catch (const std::runtime_error &)
+    {
+        thrown = true;
+    }
+    CHECK(thrown);
+
+    std::atomic<size_t> total{0};
+    auto sum = [&total](size_t i) { total += i; };
+    group.Run(100, sum);
+    CHECK(total == 4950);
+}
@@ -0,0 +1,589 @@
+#include "Test.hpp"
+#include "TestGif.hpp"
+#include "TestBlockDecode.hpp"
+#include "BlockCompress.hpp"
+#include "Image.hpp"
+#include "Log.hpp"
+#include "Texture.hpp"
+#include "TextureScheduler.hpp"
+
+#ifdef LINUX
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+// as in Texture.cpp, glad only has core OpenGL
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+
+// An OpenGL 4.1 core context without a window or a display server, on
+// Mesa's software rasterizer when there is no GPU. Tests that need one
+// skip themselves when it cannot be made.
+class OffscreenContext
+{
+public:
+    OffscreenContext()
+    {
+        // Mesa's surfaceless platform needs no display server, where it is
+        // missing the default display may still do
+        const char *extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+        if (extensions != nullptr && strstr(extensions, "EGL_MESA_platform_surfaceless") != nullptr)
+        {
+            m_display = eglGetPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        }
+        else
+        {
+            m_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        }
+        if (m_display == EGL_NO_DISPLAY || !eglInitialize(m_display, nullptr, nullptr) ||
+            !eglBindAPI(EGL_OPENGL_API))
+        {
+            return;
+        }
+        const EGLint attributes[]{EGL_CONTEXT_MAJOR_VERSION,
+                                  4,
+                                  EGL_CONTEXT_MINOR_VERSION,
+                                  1,
+                                  EGL_CONTEXT_OPENGL_PROFILE_MASK,
+                                  EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                                  EGL_NONE};
+        // no config, the context only ever draws into framebuffer objects
+        m_context = eglCreateContext(m_display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attributes);
+        if (m_context == EGL_NO_CONTEXT || !eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, m_context))
+        {
+            return;
+        }
+        m_ready = gladLoadGLLoader(reinterpret_cast<GLADloadproc>(eglGetProcAddress));
+    }
+    ~OffscreenContext()
+    {
+        if (m_context != EGL_NO_CONTEXT)
+        {
+            eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+            eglDestroyContext(m_display, m_context);
+        }
+        if (m_display != EGL_NO_DISPLAY)
+        {
+            eglTerminate(m_display);
+        }
+    }
+    inline bool IsReady() const
+    {
+        return m_ready;
+    }
+
+private:
+    EGLDisplay m_display{EGL_NO_DISPLAY};
+    EGLContext m_context{EGL_NO_CONTEXT};
+    bool m_ready{false};
+};
+
+static std::string readShader(const std::string &path)
+{
+    std::ifstream file(path);
+    std::stringstream source;
+    source << file.rdbuf();
+    return source.str();
+}
+
+static GLuint compileShader(GLenum type, const std::string &source)
+{
+    GLuint shader = glCreateShader(type);
+    const char *text = source.c_str();
+    glShaderSource(shader, 1, &text, nullptr);
+    glCompileShader(shader);
+    GLint compiled = 0;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+    if (!compiled)
+    {
+        char message[1024];
+        glGetShaderInfoLog(shader, sizeof(message), nullptr, message);
+        TestFail(__FILE__, __LINE__, std::string("shader does not compile: ") + message);
+    }
+    return shader;
+}
+
+// The project's own shaders, with the fragment shader writing the diffuse
+// color as it is looked up rather than lit, so the output can be compared
+// with the decoded pixels exactly
+static GLuint diffuseProgram()
+{
+    std::string fragment = readShader("./shaders/frag.glsl");
+    size_t main = fragment.find("void main()");
+    CHECK(main != std::string::npos);
+    if (main == std::string::npos)
+    {
+        return 0;
+    }
+    fragment.replace(main, strlen("void main()"), "void lightingMain()");
+    fragment += "\nvoid main()\n{\n\tcolor = vec4(DiffuseColor(), 1.0);\n}\n";
+
+    GLuint program = glCreateProgram();
+    GLuint vertex_shader = compileShader(GL_VERTEX_SHADER, readShader("./shaders/vert.glsl"));
+    GLuint fragment_shader = compileShader(GL_FRAGMENT_SHADER, fragment);
+    glAttachShader(program, vertex_shader);
+    glAttachShader(program, fragment_shader);
+    glLinkProgram(program);
+    glDeleteShader(vertex_shader);
+    glDeleteShader(fragment_shader);
+    GLint linked = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    CHECK(linked);
+    return program;
+}
+
+// A color renderbuffer of width x height to draw into, bound while it
+// lives
+class Framebuffer
+{
+public:
+    Framebuffer(int width, int height)
+    {
+        glGenFramebuffers(1, &m_framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+        glGenRenderbuffers(1, &m_renderbuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, m_renderbuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_renderbuffer);
+    }
+    ~Framebuffer()
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteRenderbuffers(1, &m_renderbuffer);
+        glDeleteFramebuffers(1, &m_framebuffer);
+    }
+    inline bool IsComplete() const
+    {
+        return glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    }
+
+private:
+    GLuint m_framebuffer{0};
+    GLuint m_renderbuffer{0};
+};
+
+// Draws one instance of texture per entry of phases_ms through program,
+// side by side, each over width x height pixels of the framebuffer. Reads
+// the result back as bottom-up RGB rows of every instance together.
+static std::vector<uint8_t> drawInstances(GLuint program, Texture &texture, int width, int height,
+                                          const std::vector<float> &phases_ms)
+{
+    glUseProgram(program);
+    const float identity[16]{1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+    for (const char *matrix : {"u_ModelMatrix", "u_ViewMatrix", "u_Projection"})
+    {
+        glUniformMatrix4fv(glGetUniformLocation(program, matrix), 1, GL_FALSE, identity);
+    }
+    texture.Bind(0);
+    glUniform1i(glGetUniformLocation(program, "u_DiffuseTexture"), 0);
+    glUniform1i(glGetUniformLocation(program, "u_DiffuseIndexed"), texture.IsIndexed());
+    if (texture.IsIndexed())
+    {
+        texture.BindPalette(2);
+    }
+    if (texture.IsLayered())
+    {
+        texture.BindFrames(3);
+        texture.BindFrameEnds(4);
+    }
+    glUniform1i(glGetUniformLocation(program, "u_DiffuseLayered"), texture.IsLayered());
+    glUniform1i(glGetUniformLocation(program, "u_FrameCount"), texture.GetFrameCount());
+    glUniform1i(glGetUniformLocation(program, "u_RingLayers"), texture.GetRingLayers());
+    glUniform1f(glGetUniformLocation(program, "u_AnimationTimeMs"), texture.GetAnimationTimeMs());
+    // samplers of different types cannot share the default unit 0, even
+    // when they are not read
+    glUniform1i(glGetUniformLocation(program, "u_BumpMap"), 1);
+    glUniform1i(glGetUniformLocation(program, "u_DiffusePalette"), 2);
+    glUniform1i(glGetUniformLocation(program, "u_DiffuseFrames"), 3);
+    glUniform1i(glGetUniformLocation(program, "u_FrameEnds"), 4);
+
+    // a quad over the first instance's part of the viewport, each fragment
+    // at a texel center, and instances moved along by their offset
+    float instances = static_cast<float>(phases_ms.size());
+    float right = -1.0f + 2.0f / instances;
+    const float quad[]{-1, -1, 0, 0, 0, right, -1, 0, 1, 0, -1, 1, 0, 0, 1, right, 1, 0, 1, 1};
+    std::vector<float> instance_data;
+    for (size_t i = 0; i < phases_ms.size(); ++i)
+    {
+        instance_data.insert(instance_data.end(), {phases_ms[i], 2.0f * i / instances, 0.0f, 0.0f});
+    }
+    GLuint vertex_array = 0;
+    GLuint buffers[2]{0, 0};
+    glGenVertexArrays(1, &vertex_array);
+    glBindVertexArray(vertex_array);
+    glGenBuffers(2, buffers);
+    glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(float) * 5, nullptr);
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(float) * 5, reinterpret_cast<void *>(sizeof(float) * 3));
+    // the same per instance layout as main.cpp
+    glBindBuffer(GL_ARRAY_BUFFER, buffers[1]);
+    glBufferData(GL_ARRAY_BUFFER, instance_data.size() * sizeof(float), instance_data.data(), GL_STATIC_DRAW);
+    glEnableVertexAttribArray(6);
+    glVertexAttribPointer(6, 1, GL_FLOAT, GL_FALSE, sizeof(float) * 4, nullptr);
+    glVertexAttribDivisor(6, 1);
+    glEnableVertexAttribArray(7);
+    glVertexAttribPointer(7, 3, GL_FLOAT, GL_FALSE, sizeof(float) * 4, reinterpret_cast<void *>(sizeof(float)));
+    glVertexAttribDivisor(7, 1);
+
+    int total_width = width * static_cast<int>(phases_ms.size());
+    glViewport(0, 0, total_width, height);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(phases_ms.size()));
+    std::vector<uint8_t> pixels(static_cast<size_t>(total_width) * height * 3);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, total_width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+
+    glDeleteBuffers(2, buffers);
+    glDeleteVertexArrays(1, &vertex_array);
+    return pixels;
+}
+
+// The indices Texture uploads to an R8 texture, looked up in its palette
+// texture by frag.glsl, draw what the RGB decode holds, frame after frame.
+// So does an RGB texture, as a check on the drawing itself.
+TEST(render_indexed_texture_matches_rgb_decode)
+{
+    OffscreenContext context;
+    if (!context.IsReady())
+    {
+        fprintf(stderr, "  skipped, no OpenGL context could be made\n");
+        return;
+    }
+    std::string path = MakeTestAnimation("render_indexed", 9);
+    ManualClock expected_clock;
+    Image expected(path);
+    expected.SetClock(&expected_clock);
+    expected.LoadGIF(true, PixelFormat::RGB);
+    int width = expected.GetWidth();
+    int height = expected.GetHeight();
+    const std::vector<double> &ends = expected.GetFrameEndTimesMs();
+
+    Framebuffer framebuffer(width, height);
+    CHECK(framebuffer.IsComplete());
+    GLuint program = diffuseProgram();
+
+    for (PixelFormat format : {PixelFormat::INDEXED, PixelFormat::RGB})
+    {
+        ManualClock clock;
+        AnimationOptions options;
+        options.format = format;
+        options.clock = &clock;
+        Texture texture;
+        texture.LoadTexture(path, options);
+        CHECK(texture.IsIndexed() == (format == PixelFormat::INDEXED));
+        expected_clock.Advance(-expected_clock.GetTimeMs());
+        for (size_t i = 0; i < ends.size(); ++i)
+        {
+            // both clocks at the start of frame i
+            double start = i == 0 ? 0.0 : ends[i - 1];
+            clock.Advance(start - clock.GetTimeMs());
+            expected_clock.Advance(start - expected_clock.GetTimeMs());
+            texture.Refresh();
+            const uint8_t *decoded = expected.GetPixelDataPtr();
+            // the flipped frame is stored bottom row first, as it is read
+            std::vector<uint8_t> drawn = drawInstances(program, texture, width, height, {0.0f});
+            if (memcmp(drawn.data(), decoded, drawn.size()) != 0)
+            {
+                TestFail(__FILE__, __LINE__,
+                         "frame " + std::to_string(i) + (format == PixelFormat::INDEXED ? " indexed" : " rgb") +
+                             " is drawn differently from its decode");
+            }
+        }
+    }
+    glDeleteProgram(program);
+}
+
+// Instances of an animation kept in layers each show the frame their own
+// phase puts them at. A ring only holds the frames around the one on
+// screen, so there every instance shows that frame.
+TEST(render_layered_instances_follow_their_phases)
+{
+    OffscreenContext context;
+    if (!context.IsReady())
+    {
+        fprintf(stderr, "  skipped, no OpenGL context could be made\n");
+        return;
+    }
+    const int frame_count = 9;
+    std::string path = MakeTestAnimation("render_layered", frame_count);
+    Image expected(path);
+    expected.LoadGIF(true, PixelFormat::RGB);
+    int width = expected.GetWidth();
+    int height = expected.GetHeight();
+    size_t frame_size = static_cast<size_t>(width) * height * 3;
+    std::vector<std::vector<uint8_t>> frames;
+    for (int i = 0; i < frame_count; ++i)
+    {
+        Rect dirty;
+        const uint8_t *pixels = expected.PeekFrame(i, dirty);
+        frames.emplace_back(pixels, pixels + frame_size);
+    }
+    const std::vector<double> &ends = expected.GetFrameEndTimesMs();
+    double loop_ms = ends.back();
+
+    // phases at the starts of frames 0, 3 and 7
+    std::vector<float> phases_ms{0.0f, static_cast<float>(ends[2]), static_cast<float>(ends[6])};
+    Framebuffer framebuffer(width * static_cast<int>(phases_ms.size()), height);
+    CHECK(framebuffer.IsComplete());
+    GLuint program = diffuseProgram();
+
+    for (int layers : {frame_count, 4})
+    {
+        bool ring = layers < frame_count;
+        ManualClock clock;
+        AnimationOptions options;
+        options.resident_layers = layers;
+        options.clock = &clock;
+        Texture texture;
+        texture.LoadTexture(path, options);
+        CHECK(texture.IsLayered());
+        CHECK(texture.GetRingLayers() == (ring ? layers : 0));
+        texture.SetAnimationPhasesMs(phases_ms);
+        std::vector<float> used = texture.GetAnimationPhasesMs();
+        CHECK(used == (ring ? std::vector<float>(phases_ms.size(), 0.0f) : phases_ms));
+
+        // through more than a loop, so a ring goes round
+        for (int step = 0; step < frame_count + 4; ++step)
+        {
+            // halfway into a frame, well away from any frame change
+            int shown = step % frame_count;
+            double start = (step / frame_count) * loop_ms + (shown == 0 ? 0.0 : ends[shown - 1]);
+            double time = start + (ends[shown] - (shown == 0 ? 0.0 : ends[shown - 1])) / 2;
+            clock.Advance(time - clock.GetTimeMs());
+            texture.Refresh();
+            std::vector<uint8_t> drawn = drawInstances(program, texture, width, height, used);
+            for (size_t i = 0; i < used.size(); ++i)
+            {
+                double into_loop = std::fmod(time + used[i], loop_ms);
+                size_t frame = 0;
+                while (ends[frame] <= into_loop)
+                {
+                    frame++;
+                }
+                size_t mismatches = 0;
+                for (int y = 0; y < height; ++y)
+                {
+                    size_t row = static_cast<size_t>(width) * 3;
+                    const uint8_t *drawn_row = drawn.data() + (y * used.size() + i) * row;
+                    mismatches += memcmp(drawn_row, frames[frame].data() + y * row, row) != 0;
+                }
+                if (mismatches > 0)
+                {
+                    TestFail(__FILE__, __LINE__,
+                             "instance " + std::to_string(i) + " at step " + std::to_string(step) + " does not show frame " +
+                                 std::to_string(frame) + (ring ? " in a ring" : ""));
+                }
+            }
+        }
+    }
+    glDeleteProgram(program);
+}
+
+// Writes a 2x2 GIF of frame_count frames shown for delay_cs hundredths of
+// a second each and returns its path
+static std::string writeTimedGif(const std::string &name, int frame_count, int delay_cs)
+{
+    std::vector<TestGifFrame> frames(frame_count);
+    for (int i = 0; i < frame_count; ++i)
+    {
+        frames[i].rect = Rect{0, 0, 2, 2};
+        frames[i].indices.assign(4, static_cast<uint8_t>(i));
+        frames[i].delay_cs = delay_cs;
+    }
+    std::string path = (std::filesystem::temp_directory_path() / (name + ".gif")).string();
+    WriteTestGif(path, 2, 2, {Color(0, 0, 0), Color(1, 1, 1), Color(2, 2, 2)}, frames);
+    return path;
+}
+
+// The scheduler keeps only textures that change, always has the earliest
+// deadline in front, and refreshes exactly the textures that are due before
+// putting them back with their next deadline
+TEST(scheduler_refreshes_due_textures)
+{
+    OffscreenContext context;
+    if (!context.IsReady())
+    {
+        fprintf(stderr, "  skipped, no OpenGL context could be made\n");
+        return;
+    }
+    ManualClock clock;
+    AnimationOptions options;
+    options.clock = &clock;
+    // frames of 50 ms, 9 of them for a 450 ms loop
+    Texture fast;
+    fast.LoadTexture(MakeTestAnimation("scheduler_fast", 9), options);
+    // frames of 120 ms, a 360 ms loop
+    Texture slow;
+    slow.LoadTexture(writeTimedGif("scheduler_slow", 3, 12), options);
+    Texture still;
+    still.LoadTexture(writeTimedGif("scheduler_still", 1, 12), options);
+    // played by the GPU from its layers
+    AnimationOptions resident_options = options;
+    resident_options.resident_layers = 64;
+    Texture resident;
+    resident.LoadTexture(writeTimedGif("scheduler_resident", 3, 12), resident_options);
+
+    TextureScheduler scheduler(clock);
+    for (Texture *texture : {&slow, &still, &resident, &fast})
+    {
+        scheduler.Add(texture);
+    }
+    CHECK(scheduler.GetCount() == 2);
+    CHECK(scheduler.GetNextDeadlineMs() == 50.0);
+
+    clock.Advance(49.0);
+    CHECK(scheduler.Update() == 0);
+    // a texture that is due but not refreshed yet wants a refresh now
+    clock.Advance(1.0);
+    CHECK(fast.GetNextRefreshTimeMs() == 50.0);
+    CHECK(scheduler.Update() == 1);
+    CHECK(fast.GetNextRefreshTimeMs() == 100.0);
+    CHECK(slow.GetNextRefreshTimeMs() == 120.0);
+    CHECK(scheduler.GetNextDeadlineMs() == 100.0);
+
+    clock.Advance(80.0);
+    CHECK(scheduler.Update() == 2);
+    CHECK(fast.GetNextRefreshTimeMs() == 150.0);
+    CHECK(slow.GetNextRefreshTimeMs() == 240.0);
+    CHECK(scheduler.GetNextDeadlineMs() == 150.0);
+
+    // late by several frames, each texture is refreshed once and lands on
+    // the frame of the time it is now
+    clock.Advance(870.0);
+    CHECK(scheduler.Update() == 2);
+    CHECK(scheduler.GetCount() == 2);
+    CHECK(fast.GetNextRefreshTimeMs() == 1050.0);
+    CHECK(slow.GetNextRefreshTimeMs() == 1080.0);
+    CHECK(scheduler.GetNextDeadlineMs() == 1050.0);
+
+    scheduler.Remove(&fast);
+    CHECK(scheduler.GetCount() == 1);
+    CHECK(scheduler.GetNextDeadlineMs() == 1080.0);
+    clock.Advance(80.0);
+    CHECK(scheduler.Update() == 1);
+    // the removed texture was left behind
+    CHECK(fast.GetNextRefreshTimeMs() == clock.GetTimeMs());
+    scheduler.Remove(&slow);
+    CHECK(scheduler.GetCount() == 0);
+    CHECK(std::isinf(scheduler.GetNextDeadlineMs()));
+}
+
+// Whether the context can take BC1 textures, which are an extension
+static bool hasS3TC()
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; ++i)
+    {
+        const char *name = reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, i));
+        if (strcmp(name, "GL_EXT_texture_compression_s3tc") == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// The blocks of a width x height image as the GL decodes them, in RGBA
+static std::vector<uint8_t> decodeWithGL(GLenum format, const std::vector<uint8_t> &blocks, int width, int height)
+{
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glCompressedTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, static_cast<GLsizei>(blocks.size()),
+                           blocks.data());
+    std::vector<uint8_t> rgba(static_cast<size_t>(width) * height * 4);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+    glDeleteTextures(1, &texture);
+    return rgba;
+}
+
+// The CPU decoder the block compression tests measure the encoder with
+// reads blocks the way the GL does, in every mode of both formats,
+// including the ones the encoder never writes. The formats leave the
+// precision of interpolated values to the implementation, llvmpipe's come
+// out up to 2 above the exact ones.
+TEST(render_block_decode_matches_gl)
+{
+    OffscreenContext context;
+    if (!context.IsReady())
+    {
+        fprintf(stderr, "  skipped, no OpenGL context could be made\n");
+        return;
+    }
+    const int width = 14;
+    const int height = 7;
+    std::mt19937 random(13);
+    std::vector<uint8_t> rgba(static_cast<size_t>(width) * height * 4);
+    for (uint8_t &byte : rgba)
+    {
+        byte = static_cast<uint8_t>(random());
+    }
+    std::vector<uint8_t> bc1(CompressedSize(TextureCompression::BC1, width, height));
+    std::vector<uint8_t> rgtc2(CompressedSize(TextureCompression::RGTC2, width, height));
+    CompressBC1(rgba.data(), width, height, bc1.data());
+    CompressRGTC2(rgba.data(), width, height, rgtc2.data());
+    // random bytes for the last blocks, for the three color and six value
+    // modes whichever way their endpoints fall
+    for (size_t i = bc1.size() - 16; i < bc1.size(); ++i)
+    {
+        bc1[i] = static_cast<uint8_t>(random());
+    }
+    bc1[bc1.size() - 16] = 0x00;
+    bc1[bc1.size() - 15] = 0x10;
+    bc1[bc1.size() - 14] = 0x00;
+    bc1[bc1.size() - 13] = 0x80;
+    for (size_t i = rgtc2.size() - 32; i < rgtc2.size(); ++i)
+    {
+        rgtc2[i] = static_cast<uint8_t>(random());
+    }
+    rgtc2[rgtc2.size() - 32] = 40;
+    rgtc2[rgtc2.size() - 31] = 200;
+
+    std::vector<std::pair<GLenum, std::vector<uint8_t>>> formats{{GL_COMPRESSED_RG_RGTC2, rgtc2}};
+    if (hasS3TC())
+    {
+        formats.emplace_back(GL_COMPRESSED_RGB_S3TC_DXT1_EXT, bc1);
+    }
+    else
+    {
+        fprintf(stderr, "  no S3TC support, BC1 skipped\n");
+    }
+    for (const auto &format : formats)
+    {
+        bool is_bc1 = format.first != GL_COMPRESSED_RG_RGTC2;
+        std::vector<uint8_t> expected = is_bc1 ? DecodeBC1(format.second.data(), width, height)
+                                               : DecodeRGTC2(format.second.data(), width, height);
+        std::vector<uint8_t> decoded = decodeWithGL(format.first, format.second, width, height);
+        CHECK(glGetError() == GL_NO_ERROR);
+        size_t mismatches = 0;
+        for (size_t i = 0; i < decoded.size(); ++i)
+        {
+            // an RGB texture has no transparent black, only black
+            bool alpha = i % 4 == 3;
+            if (!(is_bc1 && alpha) && std::abs(decoded[i] - expected[i]) > 2)
+            {
+                mismatches++;
+            }
+        }
+        if (mismatches > 0)
+        {
+            TestFail(__FILE__, __LINE__,
+                     std::to_string(mismatches) + (is_bc1 ? " BC1" : " RGTC2") + " bytes differ from the GL decode");
+        }
+    }
+}
+
+#endif
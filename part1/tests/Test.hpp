@@ -0,0 +1,57 @@
+/** @file Test.hpp
+ *  @brief A minimal test runner for the image and decoding code.
+ *
+ *  TEST(name) defines a test and registers it with the runner in
+ *  TestMain.cpp, CHECK(condition) records a failure without stopping the
+ *  test. Tests run without a window. On Linux the render tests draw into
+ *  an offscreen OpenGL context made through EGL, which Mesa's llvmpipe
+ *  provides without a GPU, and skip themselves where there is none.
+ *
+ *  Build and run with: python3 build.py test
+ *
+ *  @author Tvcz
+ *  @bug No known bugs.
+ */
+#ifndef TEST_HPP
+#define TEST_HPP
+
+#include <string>
+#include <vector>
+
+struct TestCase
+{
+    const char *name;
+    void (*function)();
+};
+
+// Every test in the program, in no particular order
+std::vector<TestCase> &TestRegistry();
+// Counts a failure of the running test and reports message, see CHECK
+void TestFail(const char *file, int line, const std::string &message);
+
+struct TestRegistrar
+{
+    TestRegistrar(const char *name, void (*function)())
+    {
+        TestRegistry().push_back(TestCase{name, function});
+    }
+};
+
+#define TEST(name)                                                                                                     \
+    static void test_##name();                                                                                         \
+    static TestRegistrar registrar_##name(#name, test_##name);                                                         \
+    static void test_##name()
+
+#define CHECK(condition)                                                                                               \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if (!(condition))                                                                                              \
+        {                                                                                                              \
+            TestFail(__FILE__, __LINE__, "CHECK(" #condition ") failed");                                              \
+        }                                                                                                              \
+    } while (0)
+
+// Media shared with the rest of the project, relative to part1
+#define TEST_MEDIA(path) ("../common/objects/" path)
+
+#endif
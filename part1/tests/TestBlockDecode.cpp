@@ -0,0 +1,137 @@
+#include "TestBlockDecode.hpp"
+
+static inline int readLE16(const uint8_t *source)
+{
+    return source[0] | (source[1] << 8);
+}
+
+// The 8-bit color a 565 color stands for, the top bits repeated into the
+// bottom ones
+static void expand565(int color, uint8_t rgb[3])
+{
+    int r5 = color >> 11;
+    int g6 = (color >> 5) & 63;
+    int b5 = color & 31;
+    rgb[0] = static_cast<uint8_t>((r5 << 3) | (r5 >> 2));
+    rgb[1] = static_cast<uint8_t>((g6 << 2) | (g6 >> 4));
+    rgb[2] = static_cast<uint8_t>((b5 << 3) | (b5 >> 2));
+}
+
+// Writes the 16 RGBA pixels of one BC1 block
+static void decodeBC1Block(const uint8_t *block, uint8_t pixels[64])
+{
+    int color0 = readLE16(block);
+    int color1 = readLE16(block + 2);
+    uint8_t palette[4][4];
+    expand565(color0, palette[0]);
+    expand565(color1, palette[1]);
+    for (int c = 0; c < 3; ++c)
+    {
+        if (color0 > color1)
+        {
+            palette[2][c] = static_cast<uint8_t>((2 * palette[0][c] + palette[1][c]) / 3);
+            palette[3][c] = static_cast<uint8_t>((palette[0][c] + 2 * palette[1][c]) / 3);
+        }
+        else
+        {
+            // three colors and transparent black
+            palette[2][c] = static_cast<uint8_t>((palette[0][c] + palette[1][c]) / 2);
+            palette[3][c] = 0;
+        }
+    }
+    for (int p = 0; p < 4; ++p)
+    {
+        palette[p][3] = color0 <= color1 && p == 3 ? 0 : 255;
+    }
+    uint32_t indices = static_cast<uint32_t>(readLE16(block + 4)) | (static_cast<uint32_t>(readLE16(block + 6)) << 16);
+    for (int i = 0; i < 16; ++i)
+    {
+        const uint8_t *color = palette[(indices >> (i * 2)) & 3];
+        for (int c = 0; c < 4; ++c)
+        {
+            pixels[i * 4 + c] = color[c];
+        }
+    }
+}
+
+// Writes the 16 values of one RGTC channel block to channel of pixels
+static void decodeRGTCBlock(const uint8_t *block, int channel, uint8_t pixels[64])
+{
+    int value0 = block[0];
+    int value1 = block[1];
+    int values[8]{value0, value1};
+    for (int i = 2; i < 8; ++i)
+    {
+        if (value0 > value1)
+        {
+            values[i] = ((8 - i) * value0 + (i - 1) * value1) / 7;
+        }
+        else if (i < 6)
+        {
+            values[i] = ((6 - i) * value0 + (i - 1) * value1) / 5;
+        }
+        else
+        {
+            values[i] = i == 6 ? 0 : 255;
+        }
+    }
+    uint64_t indices = 0;
+    for (int b = 0; b < 6; ++b)
+    {
+        indices |= static_cast<uint64_t>(block[2 + b]) << (b * 8);
+    }
+    for (int i = 0; i < 16; ++i)
+    {
+        pixels[i * 4 + channel] = static_cast<uint8_t>(values[(indices >> (i * 3)) & 7]);
+    }
+}
+
+// Decodes every block with decode, which fills the 16 pixels of a block
+// of block_size bytes, and copies the pixels inside the image out
+template <typename Decode>
+static std::vector<uint8_t> decodeBlocks(const uint8_t *blocks, int width, int height, size_t block_size,
+                                         Decode decode)
+{
+    std::vector<uint8_t> rgba(static_cast<size_t>(width) * height * 4);
+    uint8_t pixels[64];
+    for (int block_y = 0; block_y < (height + 3) / 4; ++block_y)
+    {
+        for (int block_x = 0; block_x < (width + 3) / 4; ++block_x)
+        {
+            decode(blocks, pixels);
+            blocks += block_size;
+            for (int y = 0; y < 4 && block_y * 4 + y < height; ++y)
+            {
+                for (int x = 0; x < 4 && block_x * 4 + x < width; ++x)
+                {
+                    uint8_t *dest = rgba.data() + (static_cast<size_t>(block_y * 4 + y) * width + block_x * 4 + x) * 4;
+                    for (int c = 0; c < 4; ++c)
+                    {
+                        dest[c] = pixels[(y * 4 + x) * 4 + c];
+                    }
+                }
+            }
+        }
+    }
+    return rgba;
+}
+
+std::vector<uint8_t> DecodeBC1(const uint8_t *blocks, int width, int height)
+{
+    return decodeBlocks(blocks, width, height, 8, decodeBC1Block);
+}
+
+std::vector<uint8_t> DecodeRGTC2(const uint8_t *blocks, int width, int height)
+{
+    return decodeBlocks(blocks, width, height, 16,
+                        [](const uint8_t *block, uint8_t pixels[64])
+                        {
+                            decodeRGTCBlock(block, 0, pixels);
+                            decodeRGTCBlock(block + 8, 1, pixels);
+                            for (int i = 0; i < 16; ++i)
+                            {
+                                pixels[i * 4 + 2] = 0;
+                                pixels[i * 4 + 3] = 255;
+                            }
+                        });
+}
@@ -0,0 +1,26 @@
+/** @file TestBlockDecode.hpp
+ *  @brief Decodes BC1 and RGTC2 blocks on the CPU for the tests.
+ *
+ *  Follows the formats as the GPU reads them, independently of the
+ *  encoder in BlockCompress, so the tests can measure what the encoder
+ *  loses without a GL context. Both formats' alternative modes are
+ *  decoded too, although the encoder never writes them.
+ *
+ *  @author Tvcz
+ *  @bug No known bugs.
+ */
+#ifndef TESTBLOCKDECODE_HPP
+#define TESTBLOCKDECODE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Decodes the blocks of a width x height image to packed RGBA, leaving out
+// the parts of the edge blocks past the image. BC1 gives alpha 255 except
+// for the transparent color of three color blocks, RGTC2 gives blue 0 and
+// alpha 255.
+std::vector<uint8_t> DecodeBC1(const uint8_t *blocks, int width, int height);
+std::vector<uint8_t> DecodeRGTC2(const uint8_t *blocks, int width, int height);
+
+#endif
@@ -0,0 +1,194 @@
+#include "TestGif.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+static const int MIN_CODE_SIZE = 4;
+static const int CLEAR_CODE = 1 << MIN_CODE_SIZE;
+static const int END_CODE = CLEAR_CODE + 1;
+// every code after the first adds a table entry, this many keep the table
+// below 32 codes so the code size never grows
+static const int LITERALS_PER_CLEAR = 12;
+
+static void writeU16(std::vector<uint8_t> &out, int value)
+{
+    out.push_back(static_cast<uint8_t>(value & 0xFF));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+}
+
+// Writes a 16 color table, padding palette with black
+static void writePalette(std::vector<uint8_t> &out, const std::vector<Color> &palette)
+{
+    for (int i = 0; i < 16; ++i)
+    {
+        Color color = i < static_cast<int>(palette.size()) ? palette[i] : Color(0, 0, 0);
+        out.insert(out.end(), {color.r, color.g, color.b});
+    }
+}
+
+// The rows of a width pixels wide frame in the order an interlaced GIF
+// stores them: every 8th row from 0, every 8th from 4, every 4th from 2
+// and every 2nd from 1
+static std::vector<uint8_t> interlaceRows(const std::vector<uint8_t> &indices, int width)
+{
+    int height = width > 0 ? static_cast<int>(indices.size()) / width : 0;
+    std::vector<uint8_t> out;
+    const int pass_start[4] = {0, 4, 2, 1};
+    const int pass_step[4] = {8, 8, 4, 2};
+    for (int pass = 0; pass < 4; ++pass)
+    {
+        for (int y = pass_start[pass]; y < height; y += pass_step[pass])
+        {
+            out.insert(out.end(), indices.begin() + y * width, indices.begin() + (y + 1) * width);
+        }
+    }
+    return out;
+}
+
+// Packs codes of MIN_CODE_SIZE + 1 bits, lowest bit first
+class CodeWriter
+{
+public:
+    void Write(int code)
+    {
+        m_bits |= static_cast<uint32_t>(code) << m_count;
+        m_count += MIN_CODE_SIZE + 1;
+        while (m_count >= 8)
+        {
+            m_bytes.push_back(static_cast<uint8_t>(m_bits & 0xFF));
+            m_bits >>= 8;
+            m_count -= 8;
+        }
+    }
+    std::vector<uint8_t> &Finish()
+    {
+        if (m_count > 0)
+        {
+            m_bytes.push_back(static_cast<uint8_t>(m_bits & 0xFF));
+        }
+        return m_bytes;
+    }
+
+private:
+    std::vector<uint8_t> m_bytes;
+    uint32_t m_bits = 0;
+    int m_count = 0;
+};
+
+std::vector<uint8_t> EncodeTestImageData(const std::vector<uint8_t> &indices)
+{
+    CodeWriter codes;
+    for (size_t i = 0; i < indices.size(); ++i)
+    {
+        if (i % LITERALS_PER_CLEAR == 0)
+        {
+            codes.Write(CLEAR_CODE);
+        }
+        codes.Write(indices[i] & 0x0F);
+    }
+    codes.Write(END_CODE);
+    const std::vector<uint8_t> &data = codes.Finish();
+
+    std::vector<uint8_t> out{MIN_CODE_SIZE};
+    for (size_t i = 0; i < data.size(); i += 255)
+    {
+        size_t size = std::min<size_t>(255, data.size() - i);
+        out.push_back(static_cast<uint8_t>(size));
+        out.insert(out.end(), data.begin() + i, data.begin() + i + size);
+    }
+    out.push_back(0);
+    return out;
+}
+
+bool WriteTestGif(const std::string &path, int width, int height, const std::vector<Color> &palette,
+                  const std::vector<TestGifFrame> &frames)
+{
+    std::vector<uint8_t> out{'G', 'I', 'F', '8', '9', 'a'};
+    writeU16(out, width);
+    writeU16(out, height);
+    // global table of 2^(3 + 1) colors, 8 bits of color resolution
+    out.push_back(0xF3);
+    out.push_back(0);
+    out.push_back(0);
+    writePalette(out, palette);
+
+    for (const TestGifFrame &frame : frames)
+    {
+        // graphic control extension
+        out.insert(out.end(), {0x21, 0xF9, 0x04});
+        out.push_back(static_cast<uint8_t>((static_cast<int>(frame.disposal) << 2) |
+                                           (frame.transparent_index >= 0 ? 1 : 0)));
+        writeU16(out, frame.delay_cs);
+        out.push_back(static_cast<uint8_t>(frame.transparent_index >= 0 ? frame.transparent_index : 0));
+        out.push_back(0);
+
+        out.push_back(0x2C);
+        writeU16(out, frame.rect.x);
+        writeU16(out, frame.rect.y);
+        writeU16(out, frame.rect.width);
+        writeU16(out, frame.rect.height);
+        uint8_t interlace_flag = frame.interlaced ? 0x40 : 0;
+        if (frame.local_palette.empty())
+        {
+            out.push_back(interlace_flag);
+        }
+        else
+        {
+            // local table of 2^(3 + 1) colors
+            out.push_back(0x83 | interlace_flag);
+            writePalette(out, frame.local_palette);
+        }
+
+        std::vector<uint8_t> data =
+            EncodeTestImageData(frame.interlaced ? interlaceRows(frame.indices, frame.rect.width) : frame.indices);
+        out.insert(out.end(), data.begin(), data.end());
+    }
+    out.push_back(0x3B);
+
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char *>(out.data()), out.size());
+    return static_cast<bool>(file);
+}
+
+std::string MakeTestAnimation(const std::string &name, int frame_count, bool local_tables, bool interlaced)
+{
+    const int width = 40;
+    const int height = 30;
+    std::vector<Color> palette;
+    for (int i = 0; i < 16; ++i)
+    {
+        palette.push_back(Color(i * 16, 255 - i * 16, (i * 97) & 0xFF));
+    }
+    std::vector<TestGifFrame> frames(frame_count);
+    for (int f = 0; f < frame_count; ++f)
+    {
+        TestGifFrame &frame = frames[f];
+        frame.interlaced = interlaced;
+        if (f == 0)
+        {
+            frame.rect = Rect{0, 0, width, height};
+        }
+        else
+        {
+            // rects that move around and touch the canvas edges
+            frame.rect = Rect{(f * 7) % (width / 2), (f * 5) % (height / 2), width / 2 + f % 3, height / 2 + f % 5};
+            frame.transparent_index = f % 2 == 0 ? 3 : -1;
+            frame.disposal = static_cast<Disposal>(f % 4);
+            for (int i = 0; local_tables && i < 16; ++i)
+            {
+                frame.local_palette.push_back(Color((i * 16 + f * 40) & 0xFF, (i * 53) & 0xFF, 255 - i * 16));
+            }
+        }
+        for (int y = 0; y < frame.rect.height; ++y)
+        {
+            for (int x = 0; x < frame.rect.width; ++x)
+            {
+                frame.indices.push_back(static_cast<uint8_t>((x / 3 + y / 2 + f) % 16));
+            }
+        }
+    }
+    std::string path = (std::filesystem::temp_directory_path() / (name + ".gif")).string();
+    WriteTestGif(path, width, height, palette, frames);
+    return path;
+}
@@ -0,0 +1,55 @@
+/** @file TestGif.hpp
+ *  @brief Writes small animated GIFs for the tests to decode.
+ *
+ *  The image data is LZW coded with literal codes only, clearing the code
+ *  table before it grows past the first code size. That is valid for any
+ *  decoder and needs no encoder, and the files stay small enough to write
+ *  at test time.
+ *
+ *  @author Tvcz
+ *  @bug No known bugs.
+ */
+#ifndef TESTGIF_HPP
+#define TESTGIF_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Frame.hpp"
+
+struct TestGifFrame
+{
+    // where the frame is drawn on the canvas
+    Rect rect;
+    // one color index per pixel of rect, row after row
+    std::vector<uint8_t> indices;
+    int transparent_index = -1;
+    Disposal disposal = Disposal::NONE;
+    // in hundredths of a second, as GIFs store it
+    int delay_cs = 5;
+    // a 16 color local table for this frame, none if empty
+    std::vector<Color> local_palette;
+    // stores the rows in the 4 pass interlaced order
+    bool interlaced = false;
+};
+
+// The image data of one frame as it follows the image descriptor: the LZW
+// minimum code size, then the codes of indices in sub-blocks, then the
+// terminating empty sub-block. Indices must be below 16.
+std::vector<uint8_t> EncodeTestImageData(const std::vector<uint8_t> &indices);
+
+// Writes a GIF89a of frames on a width x height canvas with palette as its
+// 16 color global table. Returns false if the file cannot be written.
+bool WriteTestGif(const std::string &path, int width, int height, const std::vector<Color> &palette,
+                  const std::vector<TestGifFrame> &frames);
+
+// Writes an animation of frame_count frames to the temporary directory and
+// returns its path. The frames cover the whole canvas, parts of it, use
+// transparency and every kind of disposal. With local_tables set every
+// frame after the first has a local color table of its own, with
+// interlaced set every frame is stored interlaced.
+std::string MakeTestAnimation(const std::string &name, int frame_count, bool local_tables = false,
+                              bool interlaced = false);
+
+#endif
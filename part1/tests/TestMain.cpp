@@ -0,0 +1,54 @@
+#include "Test.hpp"
+#include "Log.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+std::vector<TestCase> &TestRegistry()
+{
+    static std::vector<TestCase> tests;
+    return tests;
+}
+
+static int g_failures = 0;
+
+void TestFail(const char *file, int line, const std::string &message)
+{
+    g_failures++;
+    fprintf(stderr, "  %s:%d: %s\n", file, line, message.c_str());
+}
+
+// Runs every test, or only those whose name contains the first argument
+int main(int argc, char **argv)
+{
+    // the code under test logs as it works, only problems are of interest
+    Log::SetLevel(LogLevel::WARN);
+    std::vector<TestCase> tests = TestRegistry();
+    std::sort(tests.begin(), tests.end(),
+              [](const TestCase &a, const TestCase &b) { return strcmp(a.name, b.name) < 0; });
+    int failed = 0;
+    int ran = 0;
+    for (const TestCase &test : tests)
+    {
+        if (argc > 1 && strstr(test.name, argv[1]) == nullptr)
+        {
+            continue;
+        }
+        int before = g_failures;
+        test.function();
+        Log::Flush();
+        ran++;
+        if (g_failures != before)
+        {
+            failed++;
+            printf("FAIL %s\n", test.name);
+        }
+        else
+        {
+            printf("ok   %s\n", test.name);
+        }
+    }
+    printf("%d of %d tests passed\n", ran - failed, ran);
+    return failed == 0 ? 0 : 1;
+}